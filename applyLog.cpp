@@ -0,0 +1,81 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: applyLog.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the ApplyLog class.
+
+#include "applyLog.h"
+#include <algorithm>
+
+std::string FormatOutputs(const ResourceAmount *outputs, int count) {
+    const ResourceRegistry &registry = ResourceRegistry::Global();
+    std::string result;
+    for (int i = 0; i < count; ++i) {
+        result += std::to_string(outputs[i].quantity) + " " +
+                  registry.Name(outputs[i].id);
+        if (i < count - 1) {
+            result += ", ";
+        }
+    }
+    return result;
+}
+
+// Reserve: Grows geometrically so that reserving one step at a time, as
+// ExecutablePlan::Apply does, stays amortised O(1) per record.
+void ApplyLog::Reserve(std::size_t records, std::size_t outputTerms) {
+    if (records > steps.capacity()) {
+        records = std::max(records, 2 * steps.capacity());
+        steps.reserve(records);
+        formulaIds.reserve(records);
+        tiers.reserve(records);
+        outputEnd.reserve(records);
+    }
+    if (outputTerms > outputs.capacity()) {
+        outputs.reserve(std::max(outputTerms, 2 * outputs.capacity()));
+    }
+}
+
+void ApplyLog::Append(const ApplyRecord &record, const CompiledFormula &formula) {
+    steps.push_back(record.step);
+    formulaIds.push_back(record.formulaId);
+    tiers.push_back(record.tier);
+    for (int i = 0; i < formula.outputCount; ++i) {
+        outputs.push_back({formula.outputs[i].id,
+                           AdjustQuantity(formula.outputs[i].quantity,
+                                          record.tier)});
+    }
+    outputEnd.push_back(static_cast<std::uint32_t>(outputs.size()));
+}
+
+ApplyRecord ApplyLog::GetRecord(std::size_t index) const {
+    return ApplyRecord{steps[index], formulaIds[index], tiers[index]};
+}
+
+int ApplyLog::GetOutputCount(std::size_t index) const {
+    std::uint32_t begin = index == 0 ? 0 : outputEnd[index - 1];
+    return static_cast<int>(outputEnd[index] - begin);
+}
+
+const ResourceAmount *ApplyLog::GetOutputs(std::size_t index) const {
+    std::uint32_t begin = index == 0 ? 0 : outputEnd[index - 1];
+    return outputs.data() + begin;
+}
+
+std::string ApplyLog::Format(std::size_t index) const {
+    return FormatOutputs(GetOutputs(index), GetOutputCount(index));
+}
+
+void ApplyLog::Clear() {
+    steps.clear();
+    formulaIds.clear();
+    tiers.clear();
+    outputEnd.clear();
+    outputs.clear();
+}
+
+void ApplyLog::Truncate(std::size_t records) {
+    steps.resize(records);
+    formulaIds.resize(records);
+    tiers.resize(records);
+    outputEnd.resize(records);
+    outputs.resize(records == 0 ? 0 : outputEnd[records - 1]);
+}
@@ -0,0 +1,91 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: applyLog.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines the outcome of a formula application as a compact POD
+//              record, and ApplyLog, the columnar store the Stockpile appends
+//              those records to. Records are only turned into text when
+//              somebody asks for it.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. All columns of an ApplyLog hold exactly GetSize() entries, except the
+//    output column, which holds the outputs of every record back to back.
+// 2. outputEnd is non-decreasing; record i owns the output range
+//    [outputEnd[i - 1], outputEnd[i]).
+// 3. Stored output quantities are already adjusted by the record's tier.
+
+#ifndef APPLYLOG_H
+#define APPLYLOG_H
+
+#include "compiledPlan.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Outcome tier chosen by Formula::DetermineMultiplier.
+enum class MultiplierTier : std::uint8_t {
+    Zero = 0,
+    Reduced = 1,
+    Standard = 2,
+    Enhanced = 3
+};
+
+constexpr int TierCount = 4;
+
+// Output multiplier applied for each tier, indexed by MultiplierTier.
+constexpr double TierMultipliers[TierCount] = {0.0, 0.75, 1.0, 1.10};
+
+constexpr std::int32_t AdjustQuantity(std::int32_t quantity,
+                                      MultiplierTier tier) {
+    return static_cast<std::int32_t>(
+            quantity * TierMultipliers[static_cast<int>(tier)]);
+}
+
+// Result of applying one formula once.
+struct ApplyRecord {
+    std::uint32_t step;      // Plan step the formula was applied at
+    std::uint32_t formulaId; // Formula::GetId() of the applied formula
+    MultiplierTier tier;     // Chosen outcome tier
+};
+
+std::string FormatOutputs(const ResourceAmount *outputs, int count);
+// Formats outputs as "2 Oxygen, 1 Energy" using the global registry names.
+
+class ApplyLog {
+public:
+    void Reserve(std::size_t records, std::size_t outputTerms);
+    // Preallocates room so appending that many records and output terms
+    // does not reallocate.
+
+    void Append(const ApplyRecord &record, const CompiledFormula &formula);
+    // Appends 'record' together with the tier-adjusted outputs of 'formula'.
+    // Preconditions: 'formula' is the formula 'record' was produced by.
+
+    std::size_t GetSize() const { return steps.size(); }
+    std::size_t GetOutputTermCount() const { return outputs.size(); }
+
+    ApplyRecord GetRecord(std::size_t index) const;
+    int GetOutputCount(std::size_t index) const;
+    const ResourceAmount *GetOutputs(std::size_t index) const;
+    // Column accessors for record 'index'.
+    // Preconditions: index < GetSize().
+
+    std::string Format(std::size_t index) const;
+    // Formats the outputs of record 'index' in human-readable form.
+
+    void Clear();
+
+    void Truncate(std::size_t records);
+    // Drops every record from index 'records' on, with its outputs.
+    // Preconditions: records <= GetSize().
+
+private:
+    std::vector<std::uint32_t> steps;
+    std::vector<std::uint32_t> formulaIds;
+    std::vector<MultiplierTier> tiers;
+    std::vector<std::uint32_t> outputEnd; // Exclusive end into outputs
+    std::vector<ResourceAmount> outputs;
+};
+
+#endif // APPLYLOG_H
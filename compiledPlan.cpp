@@ -0,0 +1,132 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: compiledPlan.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the CompiledPlan class.
+
+#include "compiledPlan.h"
+#include "formula.h"
+#include "plan.h"
+#include "proficiencyTracker.h"
+#include "randomStream.h"
+#include "stockpile.h"
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+CompiledPlan::CompiledPlan(const Plan &plan) {
+    int size = plan.GetSize();
+    steps.reserve(size);
+    for (int i = 0; i < size; ++i) {
+        Append(plan.GetFormula(i));
+    }
+    ViewOwnStorage();
+}
+
+CompiledPlan::CompiledPlan(const Formula &formula) {
+    Append(formula);
+    ViewOwnStorage();
+}
+
+// External storage: Checks every step against the term buffer once, so the
+// execution loop can trust the headers, and derives the resource bound.
+CompiledPlan::CompiledPlan(const CompiledStep *stepData, std::size_t stepCount,
+                           const ResourceAmount *termData,
+                           std::size_t termCount,
+                           std::shared_ptr<const void> owner)
+        : stepData(stepData), termData(termData), stepCount(stepCount),
+          termCount(termCount), owner(std::move(owner)) {
+    if (stepCount > static_cast<std::size_t>(std::numeric_limits<int>::max()) ||
+        termCount > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("Compiled plan is too large");
+    }
+    for (std::size_t i = 0; i < stepCount; ++i) {
+        const CompiledStep &step = stepData[i];
+        if (static_cast<std::size_t>(step.offset) + step.inputCount +
+            step.outputCount > termCount) {
+            throw std::invalid_argument("Compiled step terms out of range");
+        }
+        // Levels index Formula's tier table directly
+        if (step.proficiencyLevel < 0 ||
+            step.proficiencyLevel > Formula::MaxProficiency) {
+            throw std::invalid_argument("Compiled step proficiency out of range");
+        }
+    }
+    for (std::size_t i = 0; i < termCount; ++i) {
+        if (termData[i].id >= resourceBound) {
+            resourceBound = static_cast<std::size_t>(termData[i].id) + 1;
+        }
+    }
+}
+
+void CompiledPlan::ViewOwnStorage() {
+    stepData = steps.data();
+    termData = terms.data();
+    stepCount = steps.size();
+    termCount = terms.size();
+}
+
+// Append: Flattens one formula onto the end of the shared term buffer.
+void CompiledPlan::Append(const Formula &formula) {
+    const int limit = std::numeric_limits<std::uint16_t>::max();
+    if (formula.GetInputSize() > limit || formula.GetOutputSize() > limit) {
+        throw std::length_error("Formula has too many terms to compile");
+    }
+    if (terms.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("Plan has too many terms to compile");
+    }
+
+    CompiledStep step{};
+    step.offset = static_cast<std::uint32_t>(terms.size());
+    step.inputCount = static_cast<std::uint16_t>(formula.GetInputSize());
+    step.outputCount = static_cast<std::uint16_t>(formula.GetOutputSize());
+    step.proficiencyLevel = formula.GetProficiencyLevel();
+    step.formulaId = formula.GetId();
+
+    // Inputs then outputs, through the Formula's own arrays
+    for (FormulaTerms side : {formula.GetInputs(), formula.GetOutputs()}) {
+        for (FormulaTerm term : side) {
+            terms.push_back({term.id, term.quantity});
+            if (term.id >= resourceBound) {
+                resourceBound = static_cast<std::size_t>(term.id) + 1;
+            }
+        }
+    }
+    steps.push_back(step);
+}
+
+std::size_t CompiledPlan::CountOutputTerms(int begin, int end) const {
+    std::size_t count = 0;
+    for (int i = begin; i < end; ++i) {
+        count += stepData[i].outputCount;
+    }
+    return count;
+}
+
+// Execute: The tight execution loop shared by every executor.
+RunResult CompiledPlan::Execute(int begin, int end, Stockpile &stockpile,
+                                std::uint64_t seed, bool record,
+                                std::uint64_t stepBase,
+                                ProficiencyTracker *proficiency) const {
+    for (int i = begin; i < end; ++i) {
+        CompiledFormula step = GetStep(i);
+        const std::uint64_t number = stepBase + static_cast<std::uint64_t>(i);
+        RandomStream rng(seed, number);
+        ProficiencyTracker::Progress *practice =
+                (proficiency != nullptr) ? &proficiency->Track(step.formulaId) : nullptr;
+        const int level = (practice != nullptr) ? practice->GetLevel(step.proficiencyLevel)
+                                                : step.proficiencyLevel;
+        MultiplierTier tier = Formula::DetermineMultiplier(level, rng);
+        if (!stockpile.Transact(step, tier)) {
+            return RunResult{i - begin, i};
+        }
+        if (practice != nullptr) {
+            practice->Accrue(step.proficiencyLevel);
+        }
+        if (record) {
+            stockpile.StoreFormulaResult(
+                    ApplyRecord{static_cast<std::uint32_t>(number), step.formulaId,
+                                tier}, step);
+        }
+    }
+    return RunResult{end - begin, -1};
+}
@@ -0,0 +1,151 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: compiledPlan.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines CompiledPlan, an immutable, flattened form of a Plan.
+//              Every step's input and output terms live in one contiguous
+//              buffer shared by the whole plan, addressed by a 16-byte per-step
+//              header, so executing a step reads a handful of cache lines
+//              instead of chasing pointers through std::string arrays.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. A CompiledPlan never changes after construction; it is safe to share
+//    between threads and between copies of a Plan.
+// 2. For every step, its inputs occupy terms[offset, offset + inputCount) and
+//    its outputs immediately follow them.
+// 3. Every ResourceId stored in the plan is below GetResourceBound(), so a
+//    Stockpile reserved to that bound never needs to grow while executing.
+// 4. stepData and termData point either into the plan's own vectors or into
+//    external memory kept alive by 'owner', e.g. a mapped archive file.
+
+#ifndef COMPILEDPLAN_H
+#define COMPILEDPLAN_H
+
+#include "resourceRegistry.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Formula;
+class Plan;
+class ProficiencyTracker;
+class Stockpile;
+
+// One input or output of a compiled formula.
+struct ResourceAmount {
+    ResourceId id;
+    std::int32_t quantity;
+};
+
+// Per-step header locating the step's terms in the shared buffer.
+struct CompiledStep {
+    std::uint32_t offset;
+    std::uint16_t inputCount;
+    std::uint16_t outputCount;
+    std::int32_t proficiencyLevel;
+    std::uint32_t formulaId;
+};
+
+// Non-owning view of one compiled formula.
+struct CompiledFormula {
+    const ResourceAmount *inputs;
+    int inputCount;
+    const ResourceAmount *outputs;
+    int outputCount;
+    int proficiencyLevel;
+    std::uint32_t formulaId;
+};
+
+// Outcome of running a range of steps.
+struct RunResult {
+    int stepsApplied; // Steps that completed during the run
+    int failedStep;   // Index of the step that could not be applied, or -1
+};
+
+class CompiledPlan {
+public:
+    explicit CompiledPlan(const Plan &plan);
+    // Compiles every Formula of 'plan' in order.
+    // Preconditions: No formula has more than 65535 inputs or outputs.
+    // Postconditions: GetSize() == number of formulas in 'plan'.
+
+    explicit CompiledPlan(const Formula &formula);
+    // Compiles a single Formula as a one-step plan.
+    // Preconditions: Same as above.
+    // Postconditions: GetSize() == 1.
+
+    CompiledPlan(const CompiledStep *stepData, std::size_t stepCount,
+                 const ResourceAmount *termData, std::size_t termCount,
+                 std::shared_ptr<const void> owner);
+    // Views steps and terms that live in external memory without copying
+    // them. 'owner' keeps that memory alive for the plan's lifetime.
+    // Preconditions: The ResourceIds in the terms come from the global
+    //                registry.
+    // Postconditions: Throws std::invalid_argument if a step's terms fall
+    //                 outside the term buffer, a count overflows or a
+    //                 proficiency level is out of range.
+
+    CompiledPlan(const CompiledPlan &) = delete;
+    CompiledPlan &operator=(const CompiledPlan &) = delete;
+    // Views may point into the plan's own vectors, so it is not copyable;
+    // share it through std::shared_ptr instead.
+
+    int GetSize() const { return static_cast<int>(stepCount); }
+
+    std::size_t GetResourceBound() const { return resourceBound; }
+    // Returns one past the largest ResourceId referenced by any step.
+
+    CompiledFormula GetStep(int index) const {
+        const CompiledStep &step = stepData[index];
+        const ResourceAmount *inputs = termData + step.offset;
+        return CompiledFormula{inputs, step.inputCount,
+                               inputs + step.inputCount, step.outputCount,
+                               step.proficiencyLevel, step.formulaId};
+    }
+    // Returns a view of the step at 'index'.
+    // Preconditions: 0 <= index < GetSize().
+    // Postconditions: The view stays valid for the lifetime of this object.
+
+    const CompiledStep *GetSteps() const { return stepData; }
+    const ResourceAmount *GetTerms() const { return termData; }
+    std::size_t GetTermCount() const { return termCount; }
+    // Raw step headers and term buffer, e.g. for serialization.
+
+    std::size_t CountOutputTerms(int begin, int end) const;
+    // Returns the total number of output terms of steps [begin, end).
+
+    RunResult Execute(int begin, int end, Stockpile &stockpile,
+                      std::uint64_t seed, bool record,
+                      std::uint64_t stepBase = 0,
+                      ProficiencyTracker *proficiency = nullptr) const;
+    // Applies steps [begin, end) in order, stopping at the first step whose
+    // inputs are short. Step i is numbered stepBase + i and draws its tier
+    // from RandomStream(seed, stepBase + i), so a step's outcome does not
+    // depend on which executor runs it, in what order independent steps
+    // run, or how many earlier steps were discarded from the plan. When
+    // 'record' is set, each applied step is appended to the stockpile's
+    // apply log under its number. With a 'proficiency' tracker, each step
+    // draws at its formula's tracked level instead of the compiled one and
+    // every applied step earns its formula experience.
+    // Preconditions: 0 <= begin <= end <= GetSize(); the stockpile is
+    //                reserved to GetResourceBound() and, when recording, its
+    //                log is reserved for the range, so no step allocates
+    //                (the tracker allocates once per new formula).
+    // Postconditions: The failed step, if any, left the stockpile unchanged.
+
+private:
+    void Append(const Formula &formula);
+    void ViewOwnStorage();
+
+    std::vector<CompiledStep> steps;
+    std::vector<ResourceAmount> terms; // All steps' inputs and outputs
+    const CompiledStep *stepData = nullptr;
+    const ResourceAmount *termData = nullptr;
+    std::size_t stepCount = 0;
+    std::size_t termCount = 0;
+    std::size_t resourceBound = 0;
+    std::shared_ptr<const void> owner; // Keeps external storage alive
+};
+
+#endif // COMPILEDPLAN_H
@@ -0,0 +1,231 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: concurrentStockpile.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the ConcurrentStockpile class.
+
+#include "concurrentStockpile.h"
+#include "formula.h"
+#include "proficiencyTracker.h"
+#include "randomStream.h"
+#include "stockpile.h"
+#include <stdexcept>
+#include <thread>
+
+ConcurrentStockpile::ConcurrentStockpile(std::size_t bound)
+        : bound(bound), counters(new Counter[bound]) {}
+
+void ConcurrentStockpile::AddResource(ResourceId id, std::int64_t quantity) {
+    if (id >= bound) {
+        throw std::out_of_range("Resource outside the concurrent stockpile");
+    }
+    counters[id].quantity.fetch_add(quantity, std::memory_order_relaxed);
+}
+
+bool ConcurrentStockpile::ConsumeResource(ResourceId id, std::int64_t quantity) {
+    if (id >= bound) {
+        return quantity == 0;
+    }
+    return Debit(id, quantity);
+}
+
+std::int64_t ConcurrentStockpile::GetQuantity(ResourceId id) const {
+    if (id >= bound) {
+        return 0;
+    }
+    return counters[id].quantity.load(std::memory_order_relaxed);
+}
+
+void ConcurrentStockpile::AddResource(std::string_view name, int quantity) {
+    AddResource(ResourceRegistry::Global().Intern(name), quantity);
+}
+
+bool ConcurrentStockpile::ConsumeResource(std::string_view name, int quantity) {
+    ResourceId id = ResourceRegistry::Global().Find(name);
+    if (id == InvalidResource) {
+        return false;
+    }
+    return ConsumeResource(id, quantity);
+}
+
+int ConcurrentStockpile::GetQuantity(std::string_view name) const {
+    ResourceId id = ResourceRegistry::Global().Find(name);
+    if (id == InvalidResource) {
+        return 0;
+    }
+    return static_cast<int>(GetQuantity(id));
+}
+
+// Transact: Checks the inputs while holding all their locks, so no other
+// Transact can take them in between. A lock-free ConsumeResource still
+// can, so each input is then debited with the same compare-and-swap, and
+// if one comes up short the debits already made are credited back.
+bool ConcurrentStockpile::Transact(const CompiledFormula &formula,
+                                   MultiplierTier tier) {
+    for (int i = 0; i < formula.outputCount; ++i) {
+        if (formula.outputs[i].id >= bound) {
+            throw std::out_of_range("Output outside the concurrent stockpile");
+        }
+    }
+    if (!LockInputs(formula)) {
+        return false;
+    }
+    bool enough = true;
+    for (int i = 0; i < formula.inputCount && enough; ++i) {
+        const ResourceId id = formula.inputs[i].id;
+        if (id >= bound) {
+            continue; // Needs nothing, or LockInputs would have refused
+        }
+        std::int64_t need = 0;
+        for (int j = 0; j < formula.inputCount; ++j) {
+            if (formula.inputs[j].id == id) {
+                need += formula.inputs[j].quantity;
+            }
+        }
+        enough = counters[id].quantity.load(std::memory_order_relaxed) >= need;
+    }
+    int debited = 0;
+    for (; enough && debited < formula.inputCount; ++debited) {
+        const ResourceAmount &input = formula.inputs[debited];
+        if (input.id < bound && !Debit(input.id, input.quantity)) {
+            enough = false;
+            break;
+        }
+    }
+    if (!enough) {
+        for (int i = 0; i < debited; ++i) {
+            const ResourceAmount &input = formula.inputs[i];
+            if (input.id < bound) {
+                counters[input.id].quantity.fetch_add(input.quantity,
+                                                      std::memory_order_relaxed);
+            }
+        }
+    }
+    UnlockInputs(formula);
+    if (!enough) {
+        return false;
+    }
+    for (int i = 0; i < formula.outputCount; ++i) {
+        const ResourceAmount &output = formula.outputs[i];
+        counters[output.id].quantity.fetch_add(
+                AdjustQuantity(output.quantity, tier), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+RunResult ConcurrentStockpile::Execute(const CompiledPlan &program, int begin,
+                                       int end, std::uint64_t seed,
+                                       std::uint64_t stepBase,
+                                       ProficiencyTracker *proficiency) {
+    if (program.GetResourceBound() > bound) {
+        throw std::out_of_range("Plan uses resources outside the concurrent stockpile");
+    }
+    for (int i = begin; i < end; ++i) {
+        CompiledFormula step = program.GetStep(i);
+        RandomStream rng(seed, stepBase + static_cast<std::uint64_t>(i));
+        ProficiencyTracker::Progress *practice =
+                (proficiency != nullptr) ? &proficiency->Track(step.formulaId) : nullptr;
+        const int level = (practice != nullptr) ? practice->GetLevel(step.proficiencyLevel)
+                                                : step.proficiencyLevel;
+        if (!Transact(step, Formula::DetermineMultiplier(level, rng))) {
+            return RunResult{i - begin, i};
+        }
+        if (practice != nullptr) {
+            practice->Accrue(step.proficiencyLevel);
+        }
+    }
+    return RunResult{end - begin, -1};
+}
+
+void ConcurrentStockpile::CopyTo(Stockpile &stockpile) const {
+    stockpile.Reserve(bound);
+    for (std::size_t id = 0; id < bound; ++id) {
+        std::int64_t quantity = counters[id].quantity.load(std::memory_order_relaxed);
+        if (quantity != 0) {
+            stockpile.AddResource(static_cast<ResourceId>(id), quantity);
+        }
+    }
+}
+
+// Debit: A compare-and-swap loop, so the counter never drops below zero
+// even while other threads debit it without any lock.
+bool ConcurrentStockpile::Debit(ResourceId id, std::int64_t quantity) {
+    std::atomic<std::int64_t> &counter = counters[id].quantity;
+    std::int64_t current = counter.load(std::memory_order_relaxed);
+    do {
+        if (current < quantity) {
+            return false;
+        }
+    } while (!counter.compare_exchange_weak(current, current - quantity,
+                                            std::memory_order_relaxed));
+    return true;
+}
+
+void ConcurrentStockpile::Lock(ResourceId id) {
+    std::atomic<bool> &locked = counters[id].locked;
+    while (locked.exchange(true, std::memory_order_acquire)) {
+        while (locked.load(std::memory_order_relaxed)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ConcurrentStockpile::Unlock(ResourceId id) {
+    counters[id].locked.store(false, std::memory_order_release);
+}
+
+// LockInputs: Picks the smallest not yet locked ID each round; formulas
+// have a handful of inputs, so this beats sorting a copy, and it does not
+// allocate.
+bool ConcurrentStockpile::LockInputs(const CompiledFormula &formula) {
+    for (int i = 0; i < formula.inputCount; ++i) {
+        if (formula.inputs[i].id >= bound && formula.inputs[i].quantity > 0) {
+            return false;
+        }
+    }
+    std::int64_t last = -1;
+    for (;;) {
+        std::int64_t next = static_cast<std::int64_t>(bound);
+        for (int i = 0; i < formula.inputCount; ++i) {
+            const std::int64_t id = formula.inputs[i].id;
+            if (id > last && id < next) {
+                next = id;
+            }
+        }
+        if (next == static_cast<std::int64_t>(bound)) {
+            return true;
+        }
+        Lock(static_cast<ResourceId>(next));
+        last = next;
+    }
+}
+
+void ConcurrentStockpile::UnlockInputs(const CompiledFormula &formula) {
+    for (int i = 0; i < formula.inputCount; ++i) {
+        const ResourceId id = formula.inputs[i].id;
+        bool seen = id >= bound;
+        for (int j = 0; j < i && !seen; ++j) {
+            seen = formula.inputs[j].id == id;
+        }
+        if (!seen) {
+            Unlock(id);
+        }
+    }
+}
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. Quantities only fall through Debit's compare-and-swap, which never
+//    swaps in a value below zero. Everything else only adds, so no
+//    counter is ever observed below zero.
+// 2. A Transact debits only while every input's lock is held, so other
+//    Transacts never see part of its inputs debited. A lock-free
+//    ConsumeResource can take stock between a Transact's check and its
+//    debits; the Transact then credits back what it debited, so a failed
+//    Transact leaves no trace once it returns.
+// 3. A call holding a lock only ever waits for a higher ID, so no two
+//    calls can wait on each other in a cycle.
+// 4. The lock's acquire and release order the debits of one resource.
+//    Quantities themselves use relaxed ordering: they guard no other
+//    memory. Callers that publish results between threads join them.
+// 5. Counters are 64-byte aligned, so no two resources share a cache line.
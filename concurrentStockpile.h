@@ -0,0 +1,126 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: concurrentStockpile.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines ConcurrentStockpile, an inventory that many threads
+//              can add to and consume from at once, e.g. one ExecutablePlan
+//              per production line drawing on a shared store. Every
+//              resource is an atomic counter on its own cache line, next to
+//              a spin lock. Credits are lock-free additions, and single
+//              resource consumes are lock-free compare-and-swap loops. A
+//              Transact takes the locks of every resource it consumes, in
+//              ascending ID order, so Transacts check and debit a formula's
+//              whole input set without interleaving with each other.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. No quantity is ever negative, whatever the interleaving.
+// 2. Once all threads are done, the quantities equal those of a serial
+//    Stockpile that applied the successful Transacts and ConsumeResources
+//    in some order; a failed Transact leaves no trace.
+// 3. A Transact's inputs are consumed all or nothing. Other Transacts
+//    never see part of them debited, so among Transacts one fails only if
+//    the stock really could not cover its inputs at some instant during
+//    the call. A concurrent ConsumeResource may briefly see a debit that
+//    a failing Transact then credits back.
+// 4. The set of resources is fixed at construction: GetResourceBound()
+//    never changes, so counters never move and need no lock to find.
+
+#ifndef CONCURRENTSTOCKPILE_H
+#define CONCURRENTSTOCKPILE_H
+
+#include "applyLog.h"
+#include "compiledPlan.h"
+#include "resourceRegistry.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+class ProficiencyTracker;
+class Stockpile;
+
+class ConcurrentStockpile {
+public:
+    explicit ConcurrentStockpile(std::size_t bound);
+    // Creates counters for the resource IDs below 'bound', all at zero.
+    // Preconditions: None.
+    // Postconditions: GetResourceBound() == bound.
+
+    ConcurrentStockpile(const ConcurrentStockpile &) = delete;
+    ConcurrentStockpile &operator=(const ConcurrentStockpile &) = delete;
+
+    std::size_t GetResourceBound() const { return bound; }
+
+    void AddResource(ResourceId id, std::int64_t quantity);
+    // Atomically adds 'quantity' to resource 'id'.
+    // Preconditions: quantity >= 0.
+    // Postconditions: Throws std::out_of_range if id >= GetResourceBound().
+
+    bool ConsumeResource(ResourceId id, std::int64_t quantity);
+    // Atomically removes 'quantity' of resource 'id' if that much is in
+    // stock, without taking any lock.
+    // Preconditions: quantity >= 0.
+    // Postconditions: Returns false, changing nothing, if it is not; IDs at
+    //                 or past the bound hold nothing.
+
+    std::int64_t GetQuantity(ResourceId id) const;
+    // Returns the current quantity of 'id', or 0 past the bound.
+
+    // Name API over the interned IDs above
+    void AddResource(std::string_view name, int quantity);
+    bool ConsumeResource(std::string_view name, int quantity);
+    int GetQuantity(std::string_view name) const;
+
+    bool Transact(const CompiledFormula &formula, MultiplierTier tier);
+    // Consumes every input of 'formula' and credits its outputs adjusted by
+    // 'tier', as Stockpile::Transact does, safely against any concurrent
+    // calls. If an input is short, nothing is debited and false is
+    // returned.
+    // Preconditions: None.
+    // Postconditions: Throws std::out_of_range, changing nothing, if an
+    //                 output ID is at or past GetResourceBound().
+
+    RunResult Execute(const CompiledPlan &program, int begin, int end,
+                      std::uint64_t seed, std::uint64_t stepBase = 0,
+                      ProficiencyTracker *proficiency = nullptr);
+    // Runs steps [begin, end) of 'program' against this stockpile with the
+    // same substreams, tiers and stopping rule as CompiledPlan::Execute.
+    // Nothing is logged. Many threads may execute different plans, or
+    // different ranges, at once.
+    // Preconditions: program.GetResourceBound() <= GetResourceBound();
+    //                'proficiency', if any, is not shared between threads.
+
+    void CopyTo(Stockpile &stockpile) const;
+    // Adds the current quantities to 'stockpile', e.g. to inspect them.
+    // Preconditions: No thread is modifying this stockpile.
+
+private:
+    // One counter per cache line, so threads working on different
+    // resources never contend
+    struct alignas(64) Counter {
+        std::atomic<std::int64_t> quantity{0};
+        std::atomic<bool> locked{false}; // Held by a Transact consuming it
+    };
+
+    bool Debit(ResourceId id, std::int64_t quantity);
+    // Removes 'quantity' of 'id' if that much is in stock; never drops the
+    // counter below zero. Requires id < bound.
+
+    void Lock(ResourceId id);
+    void Unlock(ResourceId id);
+    // Spin lock serializing Transacts over 'id'; credits and
+    // ConsumeResource never take it.
+
+    bool LockInputs(const CompiledFormula &formula);
+    // Locks each distinct input ID of 'formula' in ascending order, so
+    // concurrent calls cannot deadlock. Returns false, holding nothing,
+    // if an input past the bound needs anything.
+    void UnlockInputs(const CompiledFormula &formula);
+
+    std::size_t bound;
+    std::unique_ptr<Counter[]> counters; // Indexed by ResourceId
+};
+
+#endif // CONCURRENTSTOCKPILE_H
@@ -0,0 +1,124 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: ensembleRunner.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the EnsembleRunner class.
+
+#include "ensembleRunner.h"
+#include "plan.h"
+#include "stockpile.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+EnsembleRunner::EnsembleRunner(const Plan &plan, const EnsembleOptions &options)
+        : EnsembleRunner(plan.Compile(), options) {}
+
+EnsembleRunner::EnsembleRunner(std::shared_ptr<const CompiledPlan> program,
+                               const EnsembleOptions &options)
+        : program(std::move(program)), options(options) {
+    if (options.replicas < 0) {
+        throw std::invalid_argument("Replica count must be non-negative");
+    }
+}
+
+// RunReplicas: Runs replicas [begin, end) and writes each final stockpile
+// into its own row of 'finals'.
+void EnsembleRunner::RunReplicas(const Stockpile &initial, int begin, int end,
+                                 std::size_t bound, std::int64_t *finals,
+                                 int &completed) const {
+    int done = 0;
+    for (int r = begin; r < end; ++r) {
+        Stockpile stockpile;
+        stockpile.Reserve(bound);
+        for (std::size_t id = 0; id < initial.GetResourceBound(); ++id) {
+            stockpile.AddResource(static_cast<ResourceId>(id),
+                                  initial.GetQuantity(static_cast<ResourceId>(id)));
+        }
+
+        std::uint64_t seed =
+                RandomStream(options.seed, static_cast<std::uint64_t>(r)).Next();
+        RunResult result = program->Execute(0, program->GetSize(), stockpile,
+                                            seed, false);
+        if (result.failedStep < 0) {
+            ++done;
+        }
+
+        std::int64_t *row = finals + static_cast<std::size_t>(r) * bound;
+        for (std::size_t id = 0; id < bound; ++id) {
+            row[id] = stockpile.GetQuantity(static_cast<ResourceId>(id));
+        }
+    }
+    completed = done;
+}
+
+EnsembleResult EnsembleRunner::Run(const Stockpile &initial) const {
+    const int replicas = options.replicas;
+    const std::size_t bound =
+            std::max(program->GetResourceBound(), initial.GetResourceBound());
+
+    int threads = options.threads > 0
+                  ? options.threads
+                  : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, std::max(replicas, 1)));
+
+    // One row per replica; each thread owns a contiguous block of rows
+    std::vector<std::int64_t> finals(static_cast<std::size_t>(replicas) * bound);
+    std::vector<int> completed(threads, 0);
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (int t = 0; t < threads; ++t) {
+        int begin = static_cast<int>(static_cast<long long>(replicas) * t / threads);
+        int end = static_cast<int>(static_cast<long long>(replicas) * (t + 1) / threads);
+        if (t == threads - 1) {
+            RunReplicas(initial, begin, end, bound, finals.data(), completed[t]);
+        } else {
+            workers.emplace_back(&EnsembleRunner::RunReplicas, this,
+                                 std::cref(initial), begin, end, bound,
+                                 finals.data(), std::ref(completed[t]));
+        }
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    EnsembleResult result{replicas, 0, {}};
+    for (int count : completed) {
+        result.completedReplicas += count;
+    }
+
+    // Aggregate column by column; nth_element gives nearest-rank percentiles
+    std::vector<std::int64_t> column(replicas);
+    auto percentile = [&column, replicas](double p) {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(p * replicas));
+        std::size_t index = rank == 0 ? 0 : rank - 1;
+        std::nth_element(column.begin(), column.begin() + index, column.end());
+        return column[index];
+    };
+    result.resources.reserve(bound);
+    for (std::size_t id = 0; id < bound; ++id) {
+        ResourceStatistics stats{static_cast<ResourceId>(id), 0, 0, 0, 0, 0, 0, 0};
+        if (replicas > 0) {
+            double sum = 0;
+            for (int r = 0; r < replicas; ++r) {
+                column[r] = finals[static_cast<std::size_t>(r) * bound + id];
+                sum += static_cast<double>(column[r]);
+            }
+            stats.mean = sum / replicas;
+            double squares = 0;
+            for (int r = 0; r < replicas; ++r) {
+                double delta = static_cast<double>(column[r]) - stats.mean;
+                squares += delta * delta;
+            }
+            stats.variance = replicas > 1 ? squares / (replicas - 1) : 0.0;
+            stats.min = *std::min_element(column.begin(), column.end());
+            stats.max = *std::max_element(column.begin(), column.end());
+            stats.p05 = percentile(0.05);
+            stats.p50 = percentile(0.50);
+            stats.p95 = percentile(0.95);
+        }
+        result.resources.push_back(stats);
+    }
+    return result;
+}
@@ -0,0 +1,79 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: ensembleRunner.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines EnsembleRunner, which runs many independent replicas
+//              of a stochastic Plan in parallel and aggregates the final
+//              stockpiles into per-resource yield statistics.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. Replica r always runs with the seed drawn from RandomStream(seed, r), so
+//    results depend only on the plan, the initial stockpile and the options'
+//    seed, never on the number of threads.
+// 2. Replicas share only the immutable CompiledPlan and the read-only initial
+//    Stockpile; every mutable object belongs to exactly one thread.
+
+#ifndef ENSEMBLERUNNER_H
+#define ENSEMBLERUNNER_H
+
+#include "compiledPlan.h"
+#include "randomStream.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Plan;
+class Stockpile;
+
+struct EnsembleOptions {
+    int replicas = 1000;
+    std::uint64_t seed = RandomStream::DefaultSeed;
+    int threads = 0; // 0 uses every hardware thread
+};
+
+// Distribution of one resource's final quantity across replicas.
+struct ResourceStatistics {
+    ResourceId id;
+    double mean;
+    double variance;
+    std::int64_t min;
+    std::int64_t p05;
+    std::int64_t p50;
+    std::int64_t p95;
+    std::int64_t max;
+};
+
+struct EnsembleResult {
+    int replicas;
+    int completedReplicas; // Replicas that applied every step
+    std::vector<ResourceStatistics> resources; // Indexed by ResourceId
+};
+
+class EnsembleRunner {
+public:
+    EnsembleRunner(const Plan &plan, const EnsembleOptions &options);
+    // Preconditions: options.replicas >= 0.
+    // Postconditions: The plan is compiled once and shared by every replica.
+
+    EnsembleRunner(std::shared_ptr<const CompiledPlan> program,
+                   const EnsembleOptions &options);
+    // Runs an already compiled plan, e.g. one returned by LoadPlan.
+    // Preconditions: 'program' is non-null; options.replicas >= 0.
+
+    EnsembleResult Run(const Stockpile &initial) const;
+    // Runs every replica from a copy of 'initial' until it completes or a
+    // step fails, then aggregates the final quantities.
+    // Preconditions: 'initial' is not modified while Run executes.
+    // Postconditions: 'initial' is unchanged.
+
+private:
+    void RunReplicas(const Stockpile &initial, int begin, int end,
+                     std::size_t bound, std::int64_t *finals,
+                     int &completed) const;
+
+    std::shared_ptr<const CompiledPlan> program;
+    EnsembleOptions options;
+};
+
+#endif // ENSEMBLERUNNER_H
@@ -0,0 +1,106 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: eventQueue.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines EventQueue, the pending-event set of the production
+//              simulator: a 4-ary min-heap of 16-byte completion events in
+//              one flat vector. Compared with a binary heap it is half as
+//              deep, and the four children a sift-down compares are
+//              adjacent, 64 bytes in all, so each level costs about one
+//              cache line.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. events[0, size) is a 4-ary heap: the children of i are 4i + 1 to
+//    4i + 4, and no child is Before its parent.
+// 2. Events are ordered by time, then by step, so events at the same time
+//    leave the queue in step order and runs are deterministic.
+
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Completion of one step at a point in simulated time.
+struct Event {
+    std::uint64_t time; // Simulated time the step completes at
+    std::uint32_t step; // Plan step that completes
+    std::uint32_t pool; // Machine pool the step occupies until then
+};
+
+class EventQueue {
+public:
+    bool IsEmpty() const { return events.empty(); }
+    std::size_t GetSize() const { return events.size(); }
+
+    void Reserve(std::size_t count) { events.reserve(count); }
+    // Preallocates room for 'count' pending events.
+
+    const Event &Top() const { return events[0]; }
+    // Returns the earliest event.
+    // Preconditions: !IsEmpty().
+
+    void Push(const Event &event) {
+        std::size_t i = events.size();
+        events.push_back(event);
+        // Sift up: move parents down until the hole fits 'event'
+        while (i > 0) {
+            std::size_t parent = (i - 1) / Arity;
+            if (!Before(event, events[parent])) {
+                break;
+            }
+            events[i] = events[parent];
+            i = parent;
+        }
+        events[i] = event;
+    }
+
+    Event Pop() {
+        Event top = events[0];
+        Event last = events.back();
+        events.pop_back();
+        const std::size_t size = events.size();
+        if (size == 0) {
+            return top;
+        }
+        // Sift down: move the least child up until the hole fits 'last'
+        std::size_t i = 0;
+        for (;;) {
+            std::size_t first = Arity * i + 1;
+            if (first >= size) {
+                break;
+            }
+            std::size_t end = first + Arity < size ? first + Arity : size;
+            std::size_t least = first;
+            for (std::size_t c = first + 1; c < end; ++c) {
+                if (Before(events[c], events[least])) {
+                    least = c;
+                }
+            }
+            if (!Before(events[least], last)) {
+                break;
+            }
+            events[i] = events[least];
+            i = least;
+        }
+        events[i] = last;
+        return top;
+    }
+    // Removes and returns the earliest event.
+    // Preconditions: !IsEmpty().
+
+    void Clear() { events.clear(); }
+
+private:
+    static constexpr std::size_t Arity = 4;
+
+    static bool Before(const Event &a, const Event &b) {
+        return a.time < b.time || (a.time == b.time && a.step < b.step);
+    }
+
+    std::vector<Event> events;
+};
+
+#endif // EVENTQUEUE_H
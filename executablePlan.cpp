@@ -1,19 +1,25 @@
 #include "executablePlan.h"
+#include "concurrentStockpile.h"
+#include "shardedStockpile.h"
 #include "stockpile.h"
 #include <stdexcept>
 #include <utility> // For std::move
 
 // Constructor initializes the executable plan with initial formulas
 ExecutablePlan::ExecutablePlan(Formula *initialFormulas, int initialSize)
-        : Plan(initialFormulas, initialSize), _currentStep(0) {}
+        : Plan(initialFormulas, initialSize), _currentStep(0),
+          _seed(RandomStream::DefaultSeed), _firstStep(0) {}
 
 // Copy constructor
 ExecutablePlan::ExecutablePlan(const ExecutablePlan &other)
-        : Plan(other), _currentStep(other._currentStep) {}
+        : Plan(other), _currentStep(other._currentStep), _seed(other._seed),
+          _firstStep(other._firstStep), _proficiency(other._proficiency) {}
 
 // Move constructor
 ExecutablePlan::ExecutablePlan(ExecutablePlan &&other) noexcept
-        : Plan(std::move(other)), _currentStep(other._currentStep) {
+        : Plan(std::move(other)), _currentStep(other._currentStep),
+          _seed(other._seed), _firstStep(other._firstStep),
+          _proficiency(std::move(other._proficiency)) {
     other._currentStep = 0; // Reset the moved-from object's step
 }
 
@@ -22,6 +28,9 @@ ExecutablePlan &ExecutablePlan::operator=(const ExecutablePlan &other) {
     if (this != &other) {
         Plan::operator=(other); // Call base class copy assignment operator
         _currentStep = other._currentStep;
+        _seed = other._seed;
+        _firstStep = other._firstStep;
+        _proficiency = other._proficiency;
     }
     return *this;
 }
@@ -31,6 +40,9 @@ ExecutablePlan &ExecutablePlan::operator=(ExecutablePlan &&other) noexcept {
     if (this != &other) {
         Plan::operator=(std::move(other)); // Call base class move assignment operator
         _currentStep = other._currentStep;
+        _seed = other._seed;
+        _firstStep = other._firstStep;
+        _proficiency = std::move(other._proficiency);
         other._currentStep = 0; // Reset the moved-from object's step
     }
     return *this;
@@ -41,12 +53,62 @@ int ExecutablePlan::GetCurrentStep() const {
     return _currentStep;
 }
 
+std::uint64_t ExecutablePlan::GetFirstStep() const {
+    return _firstStep;
+}
+
+void ExecutablePlan::Seed(std::uint64_t seed) {
+    _seed = seed;
+}
+
+void ExecutablePlan::TrackProficiency(bool enabled) {
+    if (!enabled) {
+        _proficiency.reset();
+    } else if (!_proficiency) {
+        _proficiency.emplace();
+    }
+}
+
+const ProficiencyTracker *ExecutablePlan::GetProficiency() const {
+    return _proficiency ? &*_proficiency : nullptr;
+}
+
+// Rebuilds the plan from the unapplied formulas only; with incremental
+// feeding that is at most one batch, and usually nothing at all
+void ExecutablePlan::DiscardApplied() {
+    if (_currentStep == 0) {
+        return;
+    }
+    Plan remaining(nullptr, 0);
+    remaining.Reserve(size - _currentStep);
+    for (int i = _currentStep; i < size; ++i) {
+        remaining.Emplace(FormulaAt(i));
+    }
+    Plan::operator=(std::move(remaining));
+    _firstStep += static_cast<std::uint64_t>(_currentStep);
+    _currentStep = 0;
+}
+
 // Applies the formula at the current step and advances to the next step
-std::string ExecutablePlan::ApplyCurrentFormula() {
+ApplyRecord ExecutablePlan::ApplyCurrentFormula() {
     if (_currentStep >= size) {
         throw std::runtime_error("No more formulas to apply.");
     }
-    std::string result = formulas[_currentStep].Apply();
+    const std::uint64_t number = _firstStep + static_cast<std::uint64_t>(_currentStep);
+    RandomStream rng(_seed, number);
+    const Formula &formula = FormulaAt(_currentStep);
+    ApplyRecord result;
+    if (_proficiency) {
+        // The draw Formula::Apply makes, at the tracked level
+        int compiledLevel = formula.GetProficiencyLevel();
+        ProficiencyTracker::Progress &practice = _proficiency->Track(formula.GetId());
+        result = ApplyRecord{0, formula.GetId(), Formula::DetermineMultiplier(
+                practice.GetLevel(compiledLevel), rng)};
+        practice.Accrue(compiledLevel);
+    } else {
+        result = formula.Apply(rng);
+    }
+    result.step = static_cast<std::uint32_t>(number);
     _currentStep++; // Advance to the next step
     return result;
 }
@@ -67,49 +129,81 @@ void ExecutablePlan::Remove() {
     Plan::Remove();
 }
 
-// Assuming Formula has methods like: bool checkResources(Stockpile&), and apply(Stockpile&)
+// Applies the current formula to the stockpile as a single transaction
 std::shared_ptr<Stockpile> ExecutablePlan::Apply(std::shared_ptr<Stockpile> inputStockpile) {
     if (_currentStep >= size) {
         throw std::runtime_error("No more formulas to apply.");
     }
 
-    // Check if all required resources for the current formula are available
-    bool resourcesAvailable = true;
-    Formula& currentFormula = formulas[_currentStep];
-    for (int i = 0; i < currentFormula.GetInputSize(); ++i) {
-        std::string resourceName = currentFormula.GetInputName(i);
-        int requiredQuantity = currentFormula.GetInputQuantity(i);
-        if (inputStockpile->GetQuantity(resourceName) < requiredQuantity) {
-            resourcesAvailable = false;
-            break; // Break early if any required resource is not available
-        }
+    if (RunSteps(*inputStockpile, 1).failedStep >= 0) {
+        throw std::runtime_error("Insufficient resources to apply formula.");
     }
 
-    if (!resourcesAvailable) {
-        // If resources are not sufficient, handle as needed (e.g., throw an error)
-        throw std::runtime_error("Insufficient resources to apply formula.");
+    // For this implementation, we simply return the modified input stockpile.
+    // Depending on your requirements, you might create a new stockpile or modify this logic.
+    return inputStockpile;
+}
+
+RunResult ExecutablePlan::RunSteps(Stockpile &stockpile, int count, bool record) {
+    int end = (count < size - _currentStep) ? _currentStep + count : size;
+    if (count <= 0 || _currentStep >= end) {
+        return RunResult{0, -1};
     }
 
-    // Deduct the necessary resources from the stockpile
-    for (int i = 0; i < currentFormula.GetInputSize(); ++i) {
-        std::string resourceName = currentFormula.GetInputName(i);
-        int requiredQuantity = currentFormula.GetInputQuantity(i);
-        inputStockpile->ConsumeResource(resourceName, requiredQuantity);
+    const CompiledPlan &program = *Compile();
+    const ApplyLog &log = stockpile.GetApplyLog();
+    stockpile.Reserve(program.GetResourceBound());
+    if (record) {
+        stockpile.ReserveApplyLog(
+                log.GetSize() + (end - _currentStep),
+                log.GetOutputTermCount() +
+                program.CountOutputTerms(_currentStep, end));
     }
 
-    inputStockpile->StoreFormulaResult(currentFormula.Apply());
+    RunResult result = program.Execute(_currentStep, end, stockpile, _seed,
+                                       record, _firstStep,
+                                       _proficiency ? &*_proficiency : nullptr);
+    _currentStep += result.stepsApplied;
+    return result;
+}
 
-    // Advance to the next step
-    _currentStep++;
+RunResult ExecutablePlan::RunToCompletion(Stockpile &stockpile, bool record) {
+    return RunSteps(stockpile, size - _currentStep, record);
+}
 
-    // For this implementation, we simply return the modified input stockpile.
-    // Depending on your requirements, you might create a new stockpile or modify this logic.
-    return inputStockpile;
+template <typename Shared>
+RunResult ExecutablePlan::RunShared(Shared &stockpile, int count) {
+    int end = (count < size - _currentStep) ? _currentStep + count : size;
+    if (count <= 0 || _currentStep >= end) {
+        return RunResult{0, -1};
+    }
+    RunResult result = stockpile.Execute(*Compile(), _currentStep, end, _seed,
+                                         _firstStep,
+                                         _proficiency ? &*_proficiency : nullptr);
+    _currentStep += result.stepsApplied;
+    return result;
+}
+
+RunResult ExecutablePlan::RunSteps(ConcurrentStockpile &stockpile, int count) {
+    return RunShared(stockpile, count);
+}
+
+RunResult ExecutablePlan::RunToCompletion(ConcurrentStockpile &stockpile) {
+    return RunShared(stockpile, size - _currentStep);
+}
+
+RunResult ExecutablePlan::RunSteps(StockpileShard &shard, int count) {
+    return RunShared(shard, count);
+}
+
+RunResult ExecutablePlan::RunToCompletion(StockpileShard &shard) {
+    return RunShared(shard, size - _currentStep);
 }
 
 bool ExecutablePlan::operator==(const ExecutablePlan& other) const {
     // Assume Plan::operator== is implemented or manually compare Plan parts
-    return Plan::operator==(other) && _currentStep == other._currentStep;
+    return Plan::operator==(other) && _currentStep == other._currentStep &&
+           _firstStep == other._firstStep;
 }
 
 bool ExecutablePlan::operator!=(const ExecutablePlan& other) const {
@@ -2,11 +2,27 @@
 #define EXECUTABLEPLAN_H
 
 #include "stockpile.h"
-#include "Plan.h"
+#include "plan.h"
+#include "proficiencyTracker.h"
+#include "randomStream.h"
+#include <memory>
+#include <optional>
+
+class ConcurrentStockpile;
+class StockpileShard;
 
 class ExecutablePlan : public Plan {
 private:
     int _currentStep; // Tracks the current execution step of the plan
+    std::uint64_t _seed; // Step i draws from the substream RandomStream(_seed, i)
+    std::uint64_t _firstStep; // Number of the first retained step; earlier
+                              // steps were dropped by DiscardApplied
+    std::optional<ProficiencyTracker> _proficiency; // Set while tracking
+
+    // Runs up to 'count' steps through Shared::Execute, which takes the
+    // arguments of ConcurrentStockpile::Execute
+    template <typename Shared>
+    RunResult RunShared(Shared& stockpile, int count);
 
 public:
     // Constructor that initializes the plan with an array of formulas and size
@@ -27,8 +43,31 @@ public:
     // Returns the current execution step
     int GetCurrentStep() const;
 
+    // Returns the number of the step at index 0. Steps keep the numbers they
+    // would have in the full plan, so dropping applied steps never changes
+    // their random substreams or their numbers in the apply log.
+    std::uint64_t GetFirstStep() const;
+
+    // Drops every applied formula from the front of the plan, so a plan fed
+    // incrementally holds only the steps that have not run yet. The current
+    // step becomes index 0.
+    void DiscardApplied();
+
+    // Sets the seed of the plan's random substreams; equal seeds give
+    // identical runs, whichever executor applies the steps
+    void Seed(std::uint64_t seed);
+
+    // Starts or stops proficiency progression. While tracking, every
+    // applied step earns its formula experience and draws its tier at the
+    // formula's current level; copies of the plan carry their progress.
+    // Stopping discards the progress made.
+    void TrackProficiency(bool enabled);
+
+    // Returns the progress made while tracking, or null when not tracking
+    const ProficiencyTracker* GetProficiency() const;
+
     // Applies the formula at the current step and advances to the next step
-    std::string ApplyCurrentFormula();
+    ApplyRecord ApplyCurrentFormula();
 
     // Overrides Plan's Replace method to include validation
     void Replace(int index, Formula&& formula) ;
@@ -38,6 +77,26 @@ public:
 
     std::shared_ptr<Stockpile> Apply(std::shared_ptr<Stockpile> stockpile);
 
+    // Applies up to 'count' steps from the current step in one tight loop,
+    // stopping at the first step with insufficient resources. Nothing is
+    // thrown and nothing is allocated per step; the failed step, if any, is
+    // reported in the result and stays the current step.
+    // Unless 'record' is false, each applied step is appended to the
+    // stockpile's apply log.
+    RunResult RunSteps(Stockpile& stockpile, int count, bool record = true);
+
+    // Applies every remaining step; same contract as RunSteps
+    RunResult RunToCompletion(Stockpile& stockpile, bool record = true);
+
+    // Same as above against a stockpile shared with other threads, each
+    // running its own plan; nothing is logged
+    RunResult RunSteps(ConcurrentStockpile& stockpile, int count);
+    RunResult RunToCompletion(ConcurrentStockpile& stockpile);
+
+    // Same again against this worker's shard of a ShardedStockpile
+    RunResult RunSteps(StockpileShard& shard, int count);
+    RunResult RunToCompletion(StockpileShard& shard);
+
     bool operator==(const ExecutablePlan& other) const;
     bool operator!=(const ExecutablePlan& other) const;
     bool operator>(const ExecutablePlan& other) const;
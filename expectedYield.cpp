@@ -0,0 +1,72 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: expectedYield.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the ExpectedYieldEvaluator class.
+
+#include "expectedYield.h"
+#include "formula.h"
+#include "plan.h"
+#include "stockpile.h"
+#include <algorithm>
+#include <utility>
+
+ExpectedYieldEvaluator::ExpectedYieldEvaluator(const Plan &plan)
+        : ExpectedYieldEvaluator(plan.Compile()) {}
+
+ExpectedYieldEvaluator::ExpectedYieldEvaluator(
+        std::shared_ptr<const CompiledPlan> program)
+        : program(std::move(program)),
+          probabilities((Formula::MaxProficiency + 1) * TierCount) {
+    for (int level = 0; level <= Formula::MaxProficiency; ++level) {
+        Formula::TierProbabilities(level, &probabilities[level * TierCount]);
+    }
+}
+
+std::vector<ResourceMoments> ExpectedYieldEvaluator::Evaluate(
+        const Stockpile &initial) const {
+    const std::size_t bound =
+            std::max(program->GetResourceBound(), initial.GetResourceBound());
+    std::vector<ResourceMoments> moments(bound);
+    for (std::size_t id = 0; id < bound; ++id) {
+        moments[id] = {static_cast<ResourceId>(id),
+                       static_cast<double>(initial.GetQuantity(static_cast<ResourceId>(id))),
+                       0.0};
+    }
+
+    for (int i = 0; i < program->GetSize(); ++i) {
+        CompiledFormula step = program->GetStep(i);
+        int level = std::min(std::max(step.proficiencyLevel, 0),
+                             Formula::MaxProficiency);
+        const double *p = &probabilities[level * TierCount];
+
+        for (int k = 0; k < step.inputCount; ++k) {
+            moments[step.inputs[k].id].mean -= step.inputs[k].quantity;
+        }
+        for (int k = 0; k < step.outputCount; ++k) {
+            ResourceId id = step.outputs[k].id;
+            bool seen = false;
+            for (int j = 0; j < k && !seen; ++j) {
+                seen = step.outputs[j].id == id;
+            }
+            if (seen) {
+                continue; // Already combined with an earlier output
+            }
+            double mean = 0.0;
+            double square = 0.0;
+            for (int tier = 0; tier < TierCount; ++tier) {
+                double value = 0.0;
+                for (int j = k; j < step.outputCount; ++j) {
+                    if (step.outputs[j].id == id) {
+                        value += AdjustQuantity(step.outputs[j].quantity,
+                                                static_cast<MultiplierTier>(tier));
+                    }
+                }
+                mean += p[tier] * value;
+                square += p[tier] * value * value;
+            }
+            moments[id].mean += mean;
+            moments[id].variance += std::max(square - mean * mean, 0.0);
+        }
+    }
+    return moments;
+}
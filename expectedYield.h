@@ -0,0 +1,57 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: expectedYield.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines ExpectedYieldEvaluator, a deterministic alternative to
+//              sampling. Each step's multiplier is treated as the discrete
+//              distribution DetermineMultiplier draws from, and the means and
+//              variances of every resource are propagated through the plan in
+//              a single linear pass without any random draws.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. Every step is assumed to apply; the evaluator does not model a step
+//    failing for lack of inputs. Use EnsembleRunner when that matters.
+// 2. Steps draw independently, so their variances add. Outputs of one step
+//    that name the same resource share a tier and are combined before their
+//    variance is taken.
+// 3. Inputs are deterministic and only shift the mean.
+
+#ifndef EXPECTEDYIELD_H
+#define EXPECTEDYIELD_H
+
+#include "applyLog.h"
+#include "compiledPlan.h"
+#include <memory>
+#include <vector>
+
+class Plan;
+class Stockpile;
+
+struct ResourceMoments {
+    ResourceId id;
+    double mean;
+    double variance;
+};
+
+class ExpectedYieldEvaluator {
+public:
+    explicit ExpectedYieldEvaluator(const Plan &plan);
+    // Compiles 'plan' and tabulates tier probabilities per proficiency level.
+
+    explicit ExpectedYieldEvaluator(std::shared_ptr<const CompiledPlan> program);
+    // Evaluates an already compiled plan, e.g. one returned by LoadPlan.
+    // Preconditions: 'program' is non-null.
+
+    std::vector<ResourceMoments> Evaluate(const Stockpile &initial) const;
+    // Returns the mean and variance of each resource after the whole plan,
+    // starting from 'initial'. The result is indexed by ResourceId.
+    // Preconditions: None.
+    // Postconditions: 'initial' is unchanged.
+
+private:
+    std::shared_ptr<const CompiledPlan> program;
+    std::vector<double> probabilities; // TierCount entries per level
+};
+
+#endif // EXPECTEDYIELD_H
@@ -0,0 +1,159 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: feasibilityTable.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the FeasibilityTable class.
+
+#include "feasibilityTable.h"
+#include "stockpile.h"
+#include <algorithm>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FEASIBILITY_HAS_AVX2 1
+#endif
+
+namespace {
+
+// Padding and unused slots pass the comparison for any stock
+constexpr std::int64_t AlwaysMet = std::numeric_limits<std::int64_t>::min();
+
+#ifdef FEASIBILITY_HAS_AVX2
+// EvaluateAvx2: Four formulas per iteration. For each slot, gathers the
+// four stocks (lanes whose ID is past the stockpile read as zero without
+// touching memory) and clears the lanes whose need exceeds their stock.
+__attribute__((target("avx2")))
+void EvaluateAvx2(const std::uint32_t *ids, const std::int64_t *needs,
+                  int paddedCount, int slotCount, const std::int64_t *stock,
+                  std::size_t bound, std::uint64_t *words) {
+    const __m128i limit = _mm_set1_epi32(static_cast<int>(bound - 1));
+    const long long *base = reinterpret_cast<const long long *>(stock);
+    for (int f = 0; f < paddedCount; f += 4) {
+        __m256i met = _mm256_set1_epi64x(-1);
+        for (int s = 0; s < slotCount; ++s) {
+            const std::size_t at = static_cast<std::size_t>(s) * paddedCount + f;
+            __m128i index = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(ids + at));
+            // Unsigned index < bound, i.e. min(index, bound - 1) == index
+            __m128i inside = _mm_cmpeq_epi32(_mm_min_epu32(index, limit), index);
+            __m256i have = _mm256_mask_i32gather_epi64(
+                    _mm256_setzero_si256(), base, index,
+                    _mm256_cvtepi32_epi64(inside), 8);
+            __m256i need = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(needs + at));
+            met = _mm256_andnot_si256(_mm256_cmpgt_epi64(need, have), met);
+        }
+        std::uint64_t bits = static_cast<std::uint64_t>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(met)));
+        words[f >> 6] |= bits << (f & 63);
+    }
+}
+#endif
+
+} // namespace
+
+FeasibilityTable::FeasibilityTable(const CompiledPlan &program)
+        : count(program.GetSize()), paddedCount((program.GetSize() + 3) & ~3),
+          slotCount(0) {
+    // Merge repeated inputs per step first, to size the slots
+    std::vector<std::vector<ResourceAmount>> merged(count);
+    for (int f = 0; f < count; ++f) {
+        CompiledFormula step = program.GetStep(f);
+        for (int i = 0; i < step.inputCount; ++i) {
+            auto same = std::find_if(
+                    merged[f].begin(), merged[f].end(),
+                    [&](const ResourceAmount &input) {
+                        return input.id == step.inputs[i].id;
+                    });
+            if (same == merged[f].end()) {
+                merged[f].push_back(step.inputs[i]);
+            } else {
+                same->quantity += step.inputs[i].quantity;
+            }
+        }
+        slotCount = std::max(slotCount, static_cast<int>(merged[f].size()));
+    }
+
+    const std::size_t cells = static_cast<std::size_t>(slotCount) * paddedCount;
+    ids.assign(cells, 0);
+    needs.assign(cells, AlwaysMet);
+    for (int f = 0; f < count; ++f) {
+        for (std::size_t s = 0; s < merged[f].size(); ++s) {
+            const std::size_t at = s * paddedCount + f;
+            ids[at] = merged[f][s].id;
+            needs[at] = merged[f][s].quantity;
+        }
+    }
+}
+
+void FeasibilityTable::Evaluate(const Stockpile &stockpile,
+                                std::vector<std::uint64_t> &mask) const {
+#ifdef FEASIBILITY_HAS_AVX2
+    const std::size_t bound = stockpile.GetResourceBound();
+    // Gather indices are signed 32-bit, and an empty stockpile has nothing
+    // to gather from
+    if (HasSimd() && bound > 0 &&
+        bound <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) {
+        Prepare(mask);
+        EvaluateAvx2(ids.data(), needs.data(), paddedCount, slotCount,
+                     stockpile.GetQuantities(), bound, mask.data());
+        if (count % 64 != 0) {
+            mask.back() &= (std::uint64_t{1} << (count % 64)) - 1;
+        }
+        return;
+    }
+#endif
+    EvaluateScalar(stockpile, mask);
+}
+
+// EvaluateScalar: Works on blocks of 64 formulas so every slot row is read
+// sequentially, and builds each mask word without branches.
+void FeasibilityTable::EvaluateScalar(const Stockpile &stockpile,
+                                      std::vector<std::uint64_t> &mask) const {
+    Prepare(mask);
+    const std::int64_t *stock = stockpile.GetQuantities();
+    const std::size_t bound = stockpile.GetResourceBound();
+    for (int first = 0; first < count; first += 64) {
+        const int last = std::min(first + 64, count);
+        std::uint64_t word = (last - first == 64)
+                             ? ~std::uint64_t{0}
+                             : (std::uint64_t{1} << (last - first)) - 1;
+        for (int s = 0; s < slotCount; ++s) {
+            const std::size_t row = static_cast<std::size_t>(s) * paddedCount;
+            for (int f = first; f < last; ++f) {
+                const std::uint32_t id = ids[row + f];
+                const std::int64_t have = (id < bound) ? stock[id] : 0;
+                const bool lacking = needs[row + f] > have;
+                word &= ~(static_cast<std::uint64_t>(lacking) << (f - first));
+            }
+        }
+        mask[first >> 6] = word;
+    }
+}
+
+bool FeasibilityTable::HasSimd() {
+#ifdef FEASIBILITY_HAS_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+void FeasibilityTable::Prepare(std::vector<std::uint64_t> &mask) const {
+    mask.assign((static_cast<std::size_t>(count) + 63) / 64, 0);
+}
+
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. Both kernels compute, for every formula, AND over its slots of
+//    need <= stock, reading stock as zero for IDs at or past the stockpile's
+//    bound; the AVX2 kernel never dereferences such IDs thanks to the
+//    gather mask.
+// 2. The AVX2 kernel also sets bits for padding lanes, so Evaluate clears
+//    the bits past GetSize() in the last word afterwards.
+// 3. Prepare sizes and zeroes the mask with assign, which reuses the
+//    vector's storage when it is already large enough.
@@ -0,0 +1,73 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: feasibilityTable.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines FeasibilityTable, which answers "which of these
+//              formulas could fire right now?" for every step of a compiled
+//              plan at once. The inputs are laid out slot-major, so one
+//              vector gather fetches the stock of four formulas' k-th input
+//              and one compare checks all four; an AVX2 kernel is used when
+//              the CPU has it, with a scalar loop computing the same mask.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. Slot s of formula f lives at index s * paddedCount + f of 'ids' and
+//    'needs'. paddedCount is the formula count rounded up to a multiple of
+//    four, and slotCount is the largest number of distinct inputs of any
+//    formula.
+// 2. Repeated inputs of a formula are merged into one slot whose need is
+//    their sum, matching how Transact debits them one after another.
+// 3. Unused slots and padding lanes have need INT64_MIN, so they pass the
+//    comparison whatever the stock.
+// 4. The table never changes after construction; Evaluate is safe to call
+//    from several threads at once.
+
+#ifndef FEASIBILITYTABLE_H
+#define FEASIBILITYTABLE_H
+
+#include "compiledPlan.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Stockpile;
+
+class FeasibilityTable {
+public:
+    explicit FeasibilityTable(const CompiledPlan &program);
+    // Builds the table for every step of 'program'.
+    // Preconditions: None.
+    // Postconditions: GetSize() == program.GetSize(). Memory is
+    //                 proportional to the step count times the widest
+    //                 step's input count.
+
+    int GetSize() const { return count; }
+
+    void Evaluate(const Stockpile &stockpile,
+                  std::vector<std::uint64_t> &mask) const;
+    // Sets bit i of 'mask' (word i / 64, bit i % 64) exactly when step i
+    // has enough of every input in 'stockpile' to be applied now.
+    // Preconditions: None.
+    // Postconditions: 'mask' holds (GetSize() + 63) / 64 words; bits past
+    //                 GetSize() are zero. Nothing is allocated once 'mask'
+    //                 has reached that size.
+
+    void EvaluateScalar(const Stockpile &stockpile,
+                        std::vector<std::uint64_t> &mask) const;
+    // Same as Evaluate, always using the portable loop; for tests and
+    // benchmarks.
+
+    static bool HasSimd();
+    // Returns whether Evaluate runs the AVX2 kernel on this machine.
+
+private:
+    void Prepare(std::vector<std::uint64_t> &mask) const;
+
+    int count;                        // Formulas in the table
+    int paddedCount;                  // count rounded up to a multiple of 4
+    int slotCount;                    // Distinct inputs of the widest formula
+    std::vector<std::uint32_t> ids;   // Slot-major input IDs
+    std::vector<std::int64_t> needs;  // Slot-major input quantities
+};
+
+#endif // FEASIBILITYTABLE_H
@@ -3,20 +3,30 @@
 // DATE:     02/01/2024
 // DESCRIPTION: Implements the Formula class.
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <random>
+#include <vector>
 #include "formula.h"
 
 using namespace std;
 
+// Source of Formula identities; 0 is reserved for empty formulas
+static atomic<uint32_t> NextFormulaId(1);
+
 // Default constructor
 Formula::Formula() {
     inputNames = nullptr;
     inputQuantities = nullptr;
+    inputIds = nullptr;
     outputNames = nullptr;
     outputQuantities = nullptr;
+    outputIds = nullptr;
     inputSize = 0;
     outputSize = 0;
     proficiencyLevel = 0;
+    id = 0;
 }
 
 // Parameterized constructor for initializing formula components
@@ -41,6 +51,18 @@ Formula::Formula(
     this->outputQuantities = outputQuantities;
     this->outputSize = outputSize;
     proficiencyLevel = 0;
+    id = NextFormulaId.fetch_add(1, memory_order_relaxed);
+
+    // Resolve names to dense IDs once so execution never compares strings
+    ResourceRegistry &registry = ResourceRegistry::Global();
+    inputIds = new ResourceId[inputSize];
+    for (int i = 0; i < inputSize; ++i) {
+        inputIds[i] = registry.Intern(inputNames[i]);
+    }
+    outputIds = new ResourceId[outputSize];
+    for (int i = 0; i < outputSize; ++i) {
+        outputIds[i] = registry.Intern(outputNames[i]);
+    }
 }
 
 // Copy constructor
@@ -48,19 +70,24 @@ Formula::Formula(const Formula &other) {
     inputSize = other.inputSize;
     outputSize = other.outputSize;
     proficiencyLevel = other.proficiencyLevel;
+    id = other.id;
 
     inputNames = new string[inputSize];
     inputQuantities = new int[inputSize];
+    inputIds = new ResourceId[inputSize];
     for (int i = 0; i < inputSize; ++i) {
         inputNames[i] = other.inputNames[i];
         inputQuantities[i] = other.inputQuantities[i];
+        inputIds[i] = other.inputIds[i];
     }
 
     outputNames = new string[outputSize];
     outputQuantities = new int[outputSize];
+    outputIds = new ResourceId[outputSize];
     for (int i = 0; i < outputSize; ++i) {
         outputNames[i] = other.outputNames[i];
         outputQuantities[i] = other.outputQuantities[i];
+        outputIds[i] = other.outputIds[i];
     }
 }
 
@@ -69,25 +96,32 @@ Formula &Formula::operator=(const Formula &other) {
     if (this != &other) {
         delete[] inputNames;
         delete[] inputQuantities;
+        delete[] inputIds;
         delete[] outputNames;
         delete[] outputQuantities;
+        delete[] outputIds;
 
         inputSize = other.inputSize;
         outputSize = other.outputSize;
         proficiencyLevel = other.proficiencyLevel;
+        id = other.id;
 
         inputNames = new string[inputSize];
         inputQuantities = new int[inputSize];
+        inputIds = new ResourceId[inputSize];
         for (int i = 0; i < inputSize; ++i) {
             inputNames[i] = other.inputNames[i];
             inputQuantities[i] = other.inputQuantities[i];
+            inputIds[i] = other.inputIds[i];
         }
 
         outputNames = new string[outputSize];
         outputQuantities = new int[outputSize];
+        outputIds = new ResourceId[outputSize];
         for (int i = 0; i < outputSize; ++i) {
             outputNames[i] = other.outputNames[i];
             outputQuantities[i] = other.outputQuantities[i];
+            outputIds[i] = other.outputIds[i];
         }
     }
     return *this;
@@ -97,18 +131,21 @@ Formula &Formula::operator=(const Formula &other) {
 Formula::Formula(Formula &&other) noexcept {
     inputNames = other.inputNames;
     inputQuantities = other.inputQuantities;
+    inputIds = other.inputIds;
     inputSize = other.inputSize;
     outputNames = other.outputNames;
     outputQuantities = other.outputQuantities;
+    outputIds = other.outputIds;
     outputSize = other.outputSize;
     proficiencyLevel = other.proficiencyLevel;
-    gen = other.gen;
-    dis = other.dis;
+    id = other.id;
 
     other.inputNames = nullptr;
     other.inputQuantities = nullptr;
+    other.inputIds = nullptr;
     other.outputNames = nullptr;
     other.outputQuantities = nullptr;
+    other.outputIds = nullptr;
 }
 
 // Move assignment operator
@@ -116,23 +153,28 @@ Formula &Formula::operator=(Formula &&other) noexcept {
     if (this != &other) {
         delete[] inputNames;
         delete[] inputQuantities;
+        delete[] inputIds;
         delete[] outputNames;
         delete[] outputQuantities;
+        delete[] outputIds;
 
         inputNames = other.inputNames;
         inputQuantities = other.inputQuantities;
+        inputIds = other.inputIds;
         inputSize = other.inputSize;
         outputNames = other.outputNames;
         outputQuantities = other.outputQuantities;
+        outputIds = other.outputIds;
         outputSize = other.outputSize;
         proficiencyLevel = other.proficiencyLevel;
-        gen = other.gen;
-        dis = other.dis;
+        id = other.id;
 
         other.inputNames = nullptr;
         other.inputQuantities = nullptr;
+        other.inputIds = nullptr;
         other.outputNames = nullptr;
         other.outputQuantities = nullptr;
+        other.outputIds = nullptr;
     }
     return *this;
 }
@@ -141,15 +183,17 @@ Formula &Formula::operator=(Formula &&other) noexcept {
 Formula::~Formula() {
     delete[] inputNames;
     delete[] inputQuantities;
+    delete[] inputIds;
     delete[] outputNames;
     delete[] outputQuantities;
+    delete[] outputIds;
 }
 
-const string Formula::GetInputName(int i) const {
+string_view Formula::GetInputName(int i) const {
     if (i >= 0 && i < inputSize) {
         return inputNames[i];
     }
-    return ""; // Return empty string for invalid index
+    return {}; // Return empty view for invalid index
 }
 
 int Formula::GetInputQuantity(int i) const {
@@ -163,6 +207,65 @@ int Formula::GetInputSize() const {
     return inputSize;
 }
 
+ResourceId Formula::GetInputId(int i) const {
+    if (i >= 0 && i < inputSize) {
+        return inputIds[i];
+    }
+    return InvalidResource; // Return sentinel for invalid index
+}
+
+int Formula::GetOutputSize() const {
+    return outputSize;
+}
+
+string_view Formula::GetOutputName(int i) const {
+    if (i >= 0 && i < outputSize) {
+        return outputNames[i];
+    }
+    return {}; // Return empty view for invalid index
+}
+
+ResourceId Formula::GetOutputId(int i) const {
+    if (i >= 0 && i < outputSize) {
+        return outputIds[i];
+    }
+    return InvalidResource; // Return sentinel for invalid index
+}
+
+int Formula::GetOutputQuantity(int i) const {
+    if (i >= 0 && i < outputSize) {
+        return outputQuantities[i];
+    }
+    return 0; // Return 0 for invalid index
+}
+
+FormulaTerms Formula::GetInputs() const {
+    return FormulaTerms(inputNames, inputIds, inputQuantities, inputSize);
+}
+
+FormulaTerms Formula::GetOutputs() const {
+    return FormulaTerms(outputNames, outputIds, outputQuantities, outputSize);
+}
+
+int Formula::GetProficiencyLevel() const {
+    return proficiencyLevel;
+}
+
+void Formula::SetProficiencyLevel(int level) {
+    if (level < 0 || level > MaxProficiency) {
+        throw out_of_range("Proficiency level out of range");
+    }
+    proficiencyLevel = level;
+}
+
+uint32_t Formula::GetId() const {
+    return id;
+}
+
+uint32_t Formula::ReserveIds(uint32_t count) {
+    return NextFormulaId.fetch_add(count);
+}
+
 // Retrieves output component information by index
 string Formula::GetOutput(int index) const {
     if (index < 0 || index >= outputSize) {
@@ -171,46 +274,125 @@ string Formula::GetOutput(int index) const {
     return outputNames[index] + ": " + to_string(outputQuantities[index]);
 }
 
-// Applies the formula and calculates output based on input and proficiency level
-string Formula::Apply() {
-    string result;
-    double multiplier = DetermineMultiplier();
+// Applies the formula and records the outcome tier; no strings are built
+ApplyRecord Formula::Apply(RandomStream &rng) const {
+    return ApplyRecord{0, id, DetermineMultiplier(rng)};
+}
 
+// Formats the outputs produced by a previous Apply, only when asked for
+string Formula::Describe(const ApplyRecord &record) const {
+    string result;
     for (int i = 0; i < outputSize; ++i) {
-        int adjustedQuantity = static_cast<int>(outputQuantities[i] *
-                                                multiplier);
-        result += to_string(adjustedQuantity) + " " + outputNames[i];
-        if (i < outputSize - 1) {
+        if (i > 0) {
             result += ", ";
         }
+        result += to_string(AdjustQuantity(outputQuantities[i], record.tier));
+        result += ' ';
+        result += outputNames[i];
     }
-
     return result;
 }
 
+MultiplierTier Formula::DetermineMultiplier(RandomStream &rng) const {
+    return DetermineMultiplier(proficiencyLevel, rng);
+}
+
+// BuildTierTable: Evaluates the rate formulas once per level at compile
+// time, with the same floating-point expressions the rates are defined by.
+constexpr Formula::TierTable Formula::BuildTierTable() {
+    TierTable table{};
+    for (int level = 0; level <= MaxProficiency; ++level) {
+        int failureRate = static_cast<int>(InitialFailureRate * 100 -
+                                           ProficiencyImpact * level * 100);
+        int partialRate = static_cast<int>(InitialPartialOutputRate * 100 -
+                                           ProficiencyImpact * level * 100);
+        int normalRate = static_cast<int>(InitialNormalOutputRate * 100 +
+                                          ProficiencyImpact * level * 100);
+        int *thresholds = table.thresholds[level];
+        thresholds[0] = failureRate;
+        thresholds[1] = failureRate + partialRate;
+        thresholds[2] = failureRate + partialRate + normalRate;
+
+        // The first threshold a draw falls below picks its tier
+        for (int chance = 0; chance < TierOutcomeCount; ++chance) {
+            int tier = 0;
+            while (tier < TierCount - 1 && chance >= thresholds[tier]) {
+                ++tier;
+            }
+            table.tiers[level][chance] = static_cast<MultiplierTier>(tier);
+        }
+    }
+    return table;
+}
+
+constexpr Formula::TierTable Formula::Tiers = Formula::BuildTierTable();
+
 // Determines the multiplier based on proficiency level and random chance
-double Formula::DetermineMultiplier() {
-    // Calculate the rates based on proficiency level
-    int failureRate = static_cast<int>(InitialFailureRate * 100 -
-                                       ProficiencyImpact * proficiencyLevel *
-                                       100);
-    int partialRate = static_cast<int>(InitialPartialOutputRate * 100 -
-                                       ProficiencyImpact * proficiencyLevel *
-                                       100);
-    int normalRate = static_cast<int>(InitialNormalOutputRate * 100 +
-                                      ProficiencyImpact * proficiencyLevel *
-                                      100);
-
-    // Determine output multiplier based on random chance
-    int chance = dis(gen);
-    if (chance < failureRate)
-        return ZeroOutputMultiplier;
-    else if (chance < failureRate + partialRate)
-        return ReducedOutputMultiplier;
-    else if (chance < failureRate + partialRate + normalRate)
-        return StandardOutputMultiplier;
-    else
-        return EnhancedOutputMultiplier;
+MultiplierTier Formula::DetermineMultiplier(int proficiencyLevel,
+                                            RandomStream &rng) {
+    return Tiers.tiers[proficiencyLevel][rng.UniformInt(0, TierOutcomeCount - 1)];
+}
+
+// TierOutcomes: Counts how many of the TierOutcomeCount equally likely draws
+// of DetermineMultiplier land in each tier.
+void Formula::TierOutcomes(int proficiencyLevel, int outcomes[TierCount]) {
+    const int *thresholds = Tiers.thresholds[proficiencyLevel];
+
+    int covered = 0; // Draws below 'covered' were claimed by a lower tier
+    for (int tier = 0; tier < TierCount - 1; ++tier) {
+        int bound = min(max(thresholds[tier], 0), TierOutcomeCount);
+        outcomes[tier] = bound > covered ? bound - covered : 0;
+        covered = max(covered, bound);
+    }
+    outcomes[TierCount - 1] = TierOutcomeCount - covered;
+}
+
+void Formula::TierProbabilities(int proficiencyLevel,
+                                double probabilities[TierCount]) {
+    int outcomes[TierCount];
+    TierOutcomes(proficiencyLevel, outcomes);
+    for (int tier = 0; tier < TierCount; ++tier) {
+        probabilities[tier] =
+                static_cast<double>(outcomes[tier]) / TierOutcomeCount;
+    }
+}
+
+// SampleTierCounts: Draws the multinomial as a chain of binomials, each
+// tier taking its share of the runs the lower tiers left over. The shares
+// are exact ratios of outcome counts, so no rounding error accumulates.
+void Formula::SampleTierCounts(int proficiencyLevel, int64_t runs,
+                               RandomStream &rng, int64_t counts[TierCount]) {
+    // A binomial draw costs about as much as a few dozen plain draws, so
+    // small batches draw each run's tier directly
+    const int64_t directDrawLimit = 32;
+    if (runs <= directDrawLimit) {
+        fill(counts, counts + TierCount, 0);
+        for (int64_t run = 0; run < runs; ++run) {
+            ++counts[static_cast<int>(DetermineMultiplier(proficiencyLevel, rng))];
+        }
+        return;
+    }
+
+    int outcomes[TierCount];
+    TierOutcomes(proficiencyLevel, outcomes);
+
+    int64_t remainingRuns = runs;
+    int remainingOutcomes = TierOutcomeCount;
+    for (int tier = 0; tier < TierCount - 1; ++tier) {
+        if (remainingRuns == 0 || outcomes[tier] == 0) {
+            counts[tier] = 0;
+        } else if (outcomes[tier] == remainingOutcomes) {
+            counts[tier] = remainingRuns;
+        } else {
+            binomial_distribution<int64_t> share(
+                    remainingRuns,
+                    static_cast<double>(outcomes[tier]) / remainingOutcomes);
+            counts[tier] = share(rng);
+        }
+        remainingRuns -= counts[tier];
+        remainingOutcomes -= outcomes[tier];
+    }
+    counts[TierCount - 1] = remainingRuns;
 }
 
 bool Formula::operator==(const Formula &other) const {
@@ -251,7 +433,8 @@ bool Formula::operator!=(const Formula &other) const {
 //      manage resources efficiently.
 //    - Proficiency level and rates (_failureRate, _partialRate, _normalRate) are
 //      interdependent, ensuring consistency in output calculations.
-//    - A Random object (_random) introduces variability in output calculation.
+//    - Variability comes from a RandomStream injected by the caller; a Formula
+//      holds no generator state, so copies are cheap and runs reproducible.
 //
 // 2. Error Response:
 //    - Exception handling is employed:
@@ -263,13 +446,14 @@ bool Formula::operator!=(const Formula &other) const {
 //        level increase attempts.
 //
 // 3. Output Calculation:
-//    - The Apply() method dynamically calculates output based on the current state
-//      and multipliers.
+//    - The Apply() method picks a multiplier tier and returns it as a compact
+//      ApplyRecord; Describe() formats the adjusted outputs only on request.
 //    - Multipliers (ZeroOutputMultiplier, ReducedOutputMultiplier,
 //      StandardOutputMultiplier, EnhancedOutputMultiplier) represent different
 //      output scenarios.
 //    - Output calculation involves randomness and rate-based decision logic.
 //
 // 4. Rate Adjustment Logic:
-//    - Rates are recalculated in CalculateRates() when the proficiency level
-//      changes, ensuring alignment with the current proficiency level.
+//    - The rates of every proficiency level are turned into the Tiers table
+//      at compile time, so drawing a tier at any level is a table read and
+//      a level change, e.g. from a ProficiencyTracker, costs nothing.
@@ -27,11 +27,65 @@
 
 #include <stdexcept>
 #include <string>
-#include <random>
+#include <string_view>
 #include <cmath>
+#include <cstdint>
+#include "applyLog.h"
+#include "randomStream.h"
+#include "resourceRegistry.h"
 
 using namespace std;
 
+// One term of a formula side, as seen through FormulaTerms.
+struct FormulaTerm {
+    std::string_view name; // Points into the owning Formula
+    ResourceId id;
+    int quantity;
+};
+
+// Non-owning view over the inputs or the outputs of a Formula, valid while
+// the Formula is alive and unmodified. Indexing and iteration read the
+// Formula's own arrays and never allocate.
+class FormulaTerms {
+public:
+    class Iterator {
+    public:
+        FormulaTerm operator*() const { return (*terms)[index]; }
+        Iterator &operator++() { ++index; return *this; }
+        bool operator!=(const Iterator &other) const { return index != other.index; }
+
+    private:
+        friend class FormulaTerms;
+        Iterator(const FormulaTerms *terms, int index) : terms(terms), index(index) {}
+
+        const FormulaTerms *terms;
+        int index;
+    };
+
+    FormulaTerms(const std::string *names, const ResourceId *ids,
+                 const int *quantities, int size)
+            : names(names), ids(ids), quantities(quantities), size(size) {}
+
+    int GetSize() const { return size; }
+    bool IsEmpty() const { return size == 0; }
+
+    FormulaTerm operator[](int i) const { return {names[i], ids[i], quantities[i]}; }
+    // Preconditions: 0 <= i < GetSize().
+
+    const ResourceId *GetIds() const { return ids; }
+    const int *GetQuantities() const { return quantities; }
+    // Raw parallel arrays of GetSize() elements each.
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, size); }
+
+private:
+    const std::string *names;
+    const ResourceId *ids;
+    const int *quantities;
+    int size;
+};
+
 class Formula {
 public:
     Formula();
@@ -76,61 +130,158 @@ public:
     bool operator==(const Formula& other) const;
     bool operator!=(const Formula& other) const;
 
-    // Accessor methods for resources
-    const string GetInputName(int i) const;
+    // Accessor methods for resources. Names are views into the Formula,
+    // valid while it is alive and unmodified; an invalid index gives "".
+    std::string_view GetInputName(int i) const;
     int GetInputQuantity(int i) const;
 
     // Method to get the count of input resources
     int GetInputSize() const;
 
+    ResourceId GetInputId(int i) const;
+    // Returns the interned ID of the input at the specified index.
+    // Preconditions: None.
+    // Postconditions: Returns InvalidResource for an invalid index.
+
+    int GetOutputSize() const;
+    std::string_view GetOutputName(int i) const;
+    ResourceId GetOutputId(int i) const;
+    int GetOutputQuantity(int i) const;
+    // Accessors for output resources, mirroring the input accessors.
+    // Preconditions: None.
+    // Postconditions: Return "", InvalidResource or 0 for an invalid index.
+
+    FormulaTerms GetInputs() const;
+    FormulaTerms GetOutputs() const;
+    // Returns views over all inputs or outputs, e.g.
+    //     for (FormulaTerm input : formula.GetInputs()) { ... }
+    // Preconditions: None.
+    // Postconditions: The view is invalidated by assigning to, moving from
+    //                 or destroying the Formula.
+
+    // Highest proficiency level a formula can reach
+    static constexpr int MaxProficiency = 6;
+
+    int GetProficiencyLevel() const;
+
+    void SetProficiencyLevel(int level);
+    // Sets the level the formula's outcome tiers are drawn at, e.g. to
+    // resume from progress a ProficiencyTracker recorded.
+    // Preconditions: 0 <= level <= MaxProficiency.
+    // Postconditions: Throws out_of_range otherwise.
+
+    std::uint32_t GetId() const;
+    // Returns the formula's identity, shared by all copies of it.
+    // Preconditions: None.
+    // Postconditions: Returns 0 for a default-constructed Formula.
+
+    static std::uint32_t ReserveIds(std::uint32_t count);
+    // Reserves 'count' consecutive formula identities for formulas that
+    // exist only in compiled form, such as those loaded from an archive.
+    // Preconditions: None.
+    // Postconditions: Returns the first reserved identity; no Formula
+    //                 created later receives any of them.
+
     string GetOutput(int index) const;
-    // Returns the name of the output at the specified index.
+    // Formats the output at the specified index as "Name: quantity"; for
+    // display only, use GetOutputName or GetOutputs elsewhere.
     // Preconditions: 'index' is within the range of output array size.
-    // Postconditions: Returns the output name without modifying the Formula object.
+    // Postconditions: Throws out_of_range otherwise. The Formula is not
+    //                 modified.
 
-    string Apply();
+    ApplyRecord Apply(RandomStream &rng) const;
     // Simulates the application of the formula.
-    // Preconditions: None.
-    // Postconditions: Returns a string indicating the success or failure of the
-    // application.
+    // Preconditions: 'rng' is the caller's random stream; the formula keeps
+    //                no generator state of its own.
+    // Postconditions: Returns a record of the chosen tier; its step is 0 and
+    //                 is filled in by the executing plan.
+
+    static MultiplierTier DetermineMultiplier(int proficiencyLevel,
+                                              RandomStream &rng);
+    // Draws an outcome tier for a formula at 'proficiencyLevel'. Used by
+    // executors that run from a CompiledPlan rather than Formula objects.
+    // Preconditions: 0 <= proficiencyLevel <= MaxProficiency.
+    // Postconditions: Usually consumes one draw from 'rng'; UniformInt
+    //                 rejects and redraws in rare cases. Executors give
+    //                 each step its own (seed, substream) stream, so the
+    //                 draws a step uses never shift another step's.
+
+    static void TierProbabilities(int proficiencyLevel,
+                                  double probabilities[TierCount]);
+    // Fills 'probabilities', indexed by MultiplierTier, with the exact chance
+    // DetermineMultiplier picks each tier at 'proficiencyLevel'.
+    // Preconditions: 0 <= proficiencyLevel <= MaxProficiency.
+    // Postconditions: The probabilities are non-negative and sum to 1.
+
+    static void SampleTierCounts(int proficiencyLevel, std::int64_t runs,
+                                 RandomStream &rng,
+                                 std::int64_t counts[TierCount]);
+    // Samples how many of 'runs' applications land in each tier, from the
+    // multinomial distribution 'runs' DetermineMultiplier draws would
+    // follow. Large batches take TierCount - 1 binomial draws instead of
+    // 'runs' uniform ones.
+    // Preconditions: 0 <= proficiencyLevel <= MaxProficiency; runs >= 0.
+    // Postconditions: 'counts', indexed by MultiplierTier, sums to 'runs'.
+    //                 The exact counts for a seed depend on the standard
+    //                 library's binomial_distribution.
+
+    string Describe(const ApplyRecord &record) const;
+    // Formats the outputs 'record' produced, e.g. "2 Oxygen, 1 Energy".
+    // Preconditions: 'record' was returned by Apply on this formula.
+    // Postconditions: The Formula object is not modified.
 
 private:
     std::string *inputNames; // Dynamically allocated array of input names
     int *inputQuantities;    // Dynamically allocated array of input quantities
+    ResourceId *inputIds;    // Interned IDs parallel to inputNames
     int inputSize;           // Size of the input arrays
 
 
 
     std::string *outputNames;    // Dynamically allocated array of output names
     int *outputQuantities;       // Dynamically allocated array of output quantities
+    ResourceId *outputIds;       // Interned IDs parallel to outputNames
     int outputSize;              // Size of the output arrays
 
-    std::random_device rd;       // Random device for generating random numbers
-    // Mersenne Twister generator
-    std::mt19937 gen = std::mt19937(rd());
-    // Uniform distribution for random numbers
-    std::uniform_int_distribution<> dis =
-            std::uniform_int_distribution<>(0, 100);
-
     int proficiencyLevel;        // Proficiency level affecting the formula outcome
+    std::uint32_t id;            // Identity recorded in ApplyRecord
 
     // Constants related to formula application outcomes
-    const int MaxProficiency = 6;
-    const double InitialFailureRate = 0.30;
-    const double InitialPartialOutputRate = 0.25;
-    const double InitialNormalOutputRate = 0.45;
-    const double ProficiencyImpact = 0.05;
-
-    const double ZeroOutputMultiplier = 0.0;
-    const double ReducedOutputMultiplier = 0.75;
-    const double StandardOutputMultiplier = 1.0;
-    const double EnhancedOutputMultiplier = 1.10;
-
-    double DetermineMultiplier();
+    static constexpr double InitialFailureRate = 0.30;
+    static constexpr double InitialPartialOutputRate = 0.25;
+    static constexpr double InitialNormalOutputRate = 0.45;
+    static constexpr double ProficiencyImpact = 0.05;
+
+    static constexpr double ZeroOutputMultiplier =
+            TierMultipliers[static_cast<int>(MultiplierTier::Zero)];
+    static constexpr double ReducedOutputMultiplier =
+            TierMultipliers[static_cast<int>(MultiplierTier::Reduced)];
+    static constexpr double StandardOutputMultiplier =
+            TierMultipliers[static_cast<int>(MultiplierTier::Standard)];
+    static constexpr double EnhancedOutputMultiplier =
+            TierMultipliers[static_cast<int>(MultiplierTier::Enhanced)];
+
+    // DetermineMultiplier draws one of this many equally likely outcomes
+    static constexpr int TierOutcomeCount = 101;
+
+    // Per-level tier lookup, built at compile time from the rate constants
+    // above: the cumulative thresholds, and the tier each of the
+    // TierOutcomeCount draws selects, so a draw costs one table read
+    struct TierTable {
+        int thresholds[MaxProficiency + 1][TierCount - 1];
+        MultiplierTier tiers[MaxProficiency + 1][TierOutcomeCount];
+    };
+    static constexpr TierTable BuildTierTable();
+    static const TierTable Tiers;
+
+    static void TierOutcomes(int proficiencyLevel, int outcomes[TierCount]);
+    // Counts the outcomes that select each tier; they sum to TierOutcomeCount.
+
+    MultiplierTier DetermineMultiplier(RandomStream &rng) const;
     // Determines the output multiplier based on the proficiency level.
     // Preconditions: None.
-    // Postconditions: Returns a multiplier value based on the proficiency level
-    //                 which affects the formula's output efficiency.
+    // Postconditions: Returns the multiplier tier based on the proficiency
+    //                 level which affects the formula's output efficiency.
 };
 
 #endif
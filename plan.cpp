@@ -5,53 +5,109 @@
 
 #include "plan.h"
 #include "formula.h"
+#include <atomic>
+#include <new>
 #include <stdexcept>
 #include <utility>
 
 using namespace std;
 
-// Constructor: Initializes a Plan object with an array of initial formulas and size.
-Plan::Plan(Formula *initialFormulas, int initialSize) {
-    size = initialSize;
-    capacity = initialSize;
-    formulas = new Formula[capacity];
-    for (int i = 0; i < size; ++i) {
-        formulas[i] = initialFormulas[i];
+// Chunk copy constructor: Copies the other chunk's Formulas into this one,
+// releasing them again if a copy throws.
+Plan::Chunk::Chunk(const Chunk &other) : count(0) {
+    try {
+        for (int i = 0; i < other.count; ++i) {
+            Emplace(other[i]);
+        }
+    } catch (...) {
+        while (count > 0) {
+            PopBack();
+        }
+        throw;
     }
 }
 
-// Copy Constructor: Creates a new Plan object by copying another Plan object.
-Plan::Plan(const Plan &other) {
-    size = other.size;
-    capacity = other.capacity;
-    formulas = new Formula[capacity];
-    for (int i = 0; i < size; ++i) {
-        formulas[i] = other.formulas[i];
+// Chunk destructor: Destroys in reverse order, as delete[] does, which also
+// hands the formulas' buffers back to the allocator in LIFO order.
+Plan::Chunk::~Chunk() {
+    while (count > 0) {
+        PopBack();
     }
 }
 
-// Move Constructor: Creates a new Plan object by moving another Plan object.
-Plan::Plan(Plan &&other) noexcept {
-    formulas = other.formulas;
-    size = other.size;
-    capacity = other.capacity;
+void Plan::Chunk::PopBack() {
+    --count;
+    (*this)[count].~Formula();
+}
+
+// IsUnique: True if 'pointer' holds the only reference left. use_count() is
+// only a relaxed load, so the acquire fence is what orders the caller's
+// writes after the reads other copies made before dropping their references.
+template <typename T>
+static bool IsUnique(const shared_ptr<T> &pointer) {
+    if (pointer.use_count() != 1) {
+        return false;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return true;
+}
 
-    other.formulas = nullptr;
+// MutableTable: Copy-on-write for the chunk table. Cloning copies only the
+// chunk pointers, so the chunks themselves stay shared.
+Plan::ChunkTable &Plan::MutableTable() {
+    if (!chunks) {
+        chunks = make_shared<ChunkTable>();
+    } else if (!IsUnique(chunks)) {
+        chunks = make_shared<ChunkTable>(*chunks);
+    }
+    return *chunks;
+}
+
+// MutableChunk: Copy-on-write for a single chunk.
+Plan::Chunk &Plan::MutableChunk(int chunkIndex) {
+    shared_ptr<Chunk> &chunk = MutableTable()[chunkIndex];
+    if (!IsUnique(chunk)) {
+        chunk = make_shared<Chunk>(*chunk);
+    }
+    return *chunk;
+}
+
+Plan::Chunk &Plan::AppendChunk() {
+    if ((size & ChunkMask) == 0) {
+        ChunkTable &table = MutableTable();
+        table.push_back(make_shared<Chunk>());
+        return *table.back();
+    }
+    return MutableChunk(size >> ChunkShift);
+}
+
+// Constructor: Initializes a Plan object with an array of initial formulas and size.
+Plan::Plan(Formula *initialFormulas, int initialSize) : size(0) {
+    Reserve(initialSize);
+    for (int i = 0; i < initialSize; ++i) {
+        Emplace(initialFormulas[i]);
+    }
+}
+
+// Copy Constructor: Shares the other Plan's chunks; they are cloned lazily
+// by whichever Plan mutates first.
+Plan::Plan(const Plan &other)
+        : chunks(other.chunks), size(other.size), compiled(other.compiled) {
+}
+
+// Move Constructor: Creates a new Plan object by moving another Plan object.
+Plan::Plan(Plan &&other) noexcept
+        : chunks(std::move(other.chunks)), size(other.size),
+          compiled(std::move(other.compiled)) {
     other.size = 0;
-    other.capacity = 0;
 }
 
-// Copy Assignment Operator: Copies the content of another Plan object to this one.
+// Copy Assignment Operator: Shares the other Plan's chunks.
 Plan &Plan::operator=(const Plan &other) {
     if (this != &other) {
-        Formula *newFormulas = new Formula[other.capacity];
-        for (int i = 0; i < other.size; ++i) {
-            newFormulas[i] = other.formulas[i];
-        }
-        delete[] formulas;
-        formulas = newFormulas;
+        chunks = other.chunks;
         size = other.size;
-        capacity = other.capacity;
+        compiled = other.compiled;
     }
     return *this;
 }
@@ -59,57 +115,76 @@ Plan &Plan::operator=(const Plan &other) {
 // Move Assignment Operator: Moves the content of another Plan object to this one.
 Plan &Plan::operator=(Plan &&other) noexcept {
     if (this != &other) {
-        delete[] formulas;
-        formulas = other.formulas;
+        chunks = std::move(other.chunks);
         size = other.size;
-        capacity = other.capacity;
+        compiled = std::move(other.compiled);
 
-        other.formulas = nullptr;
         other.size = 0;
-        other.capacity = 0;
     }
     return *this;
 }
 
-// Destructor: Destroys the Plan object and frees its resources.
+// Destructor: Releases this Plan's references; chunks no longer shared by any
+// Plan are destroyed, last chunk first.
 Plan::~Plan() {
-    delete[] formulas;
+    if (chunks && IsUnique(chunks)) {
+        while (!chunks->empty()) {
+            chunks->pop_back();
+        }
+    }
 }
 
 // Add: Adds a new formula at the end of the Plan.
 void Plan::Add(Formula &&formula) {
-    if (size == capacity) {
-        ResizeIfNeeded();
+    Emplace(std::move(formula));
+}
+
+// Reserve: Sizes the chunk table up front so the next Adds do not grow it.
+void Plan::Reserve(int newCapacity) {
+    if (newCapacity > size) {
+        MutableTable().reserve((newCapacity + ChunkMask) >> ChunkShift);
     }
-    formulas[size++] = std::move(formula);
 }
 
 // Remove: Removes the last formula from the Plan.
 void Plan::Remove() {
     if (size > 0) {
         --size;
+        if ((size & ChunkMask) == 0) {
+            MutableTable().pop_back();
+        } else {
+            MutableChunk(size >> ChunkShift).PopBack();
+        }
+        compiled.reset();
     }
 }
 
-// Replace: Replaces a formula at a specified index.
+// Replace: Replaces a formula at a specified index, cloning only its chunk.
 void Plan::Replace(int index, Formula &&formula) {
     if (index < 0 || index >= size) {
         throw std::out_of_range("Index out of range");
     }
-    formulas[index] = std::move(formula);
+    MutableChunk(index >> ChunkShift)[index & ChunkMask] = std::move(formula);
+    compiled.reset();
 }
 
-// ResizeIfNeeded: Expands the capacity of the Plan when the current capacity is
-// not enough to hold more formulas.
-void Plan::ResizeIfNeeded() {
-    int newCapacity = (capacity == 0) ? 1 : capacity * 2;
-    Formula *newFormulas = new Formula[newCapacity];
-    for (int i = 0; i < size; ++i) {
-        newFormulas[i] = std::move(formulas[i]);
+int Plan::GetSize() const {
+    return size;
+}
+
+const Formula &Plan::GetFormula(int index) const {
+    if (index < 0 || index >= size) {
+        throw std::out_of_range("Index out of range");
     }
-    delete[] formulas;
-    formulas = newFormulas;
-    capacity = newCapacity;
+    return FormulaAt(index);
+}
+
+// Compile: Returns the cached compiled form, rebuilding it after mutations.
+shared_ptr<const CompiledPlan> Plan::Compile() const {
+    if (!compiled) {
+        compiled = make_shared<const CompiledPlan>(*this);
+    }
+    return compiled;
 }
 
 // DisplayFormulas: Returns a string containing information about all formulas.
@@ -117,10 +192,17 @@ string Plan::DisplayFormulas() const {
     if (size == 0) {
         return "No formula";
     }
+    // A fixed seed keeps the display deterministic for a given Plan
+    RandomStream rng;
+    // Appends in place rather than concatenating temporaries per formula
     string output;
     for (int i = 0; i < size; ++i) {
-        output += "Formula " + to_string(i + 1) + ": " + formulas[i].Apply() +
-                  "\n";
+        const Formula &formula = FormulaAt(i);
+        output += "Formula ";
+        output += to_string(i + 1);
+        output += ": ";
+        output += formula.Describe(formula.Apply(rng));
+        output += '\n';
     }
     return output;
 }
@@ -130,8 +212,18 @@ bool Plan::operator==(const Plan& other) const {
         return false; // Different number of formulas
     }
 
+    if (chunks == other.chunks) {
+        return true; // Same shared storage
+    }
+
     for (int i = 0; i < size; ++i) {
-        if (!(formulas[i] == other.formulas[i])) {
+        // Chunks shared between the two Plans need no comparison
+        if ((i & ChunkMask) == 0 &&
+            (*chunks)[i >> ChunkShift] == (*other.chunks)[i >> ChunkShift]) {
+            i += ChunkMask;
+            continue;
+        }
+        if (!(FormulaAt(i) == other.FormulaAt(i))) {
             return false; // Found formulas that are not equal
         }
     }
@@ -165,50 +257,59 @@ bool Plan::operator<=(const Plan& other) const {
 //
 // 1. Constructor:
 //    - The constructor initializes a Plan object with an array of initial formulas
-//      and size. It allocates dynamic memory for the formulas array, copying the
-//      provided formulas.
+//      and size. It copy-constructs the provided formulas into chunks; unused
+//      chunk slots are never constructed.
 //
 // 2. Copy Constructor:
-//    - The copy constructor creates a new Plan object by deep copying another Plan
-//      object. It ensures that the new Plan has its own copy of the formulas.
+//    - The copy constructor shares the other Plan's chunk table in O(1). Neither
+//      Plan modifies a chunk or the table while it is shared, so each behaves as
+//      an independent copy.
 //
 // 3. Move Constructor:
 //    - The move constructor transfers ownership of resources from another Plan
-//      object to the new Plan object. It efficiently transfers the formulas array
+//      object to the new Plan object. It efficiently transfers the chunk table
 //      and resets the other Plan's resources.
 //
 // 4. Copy Assignment Operator:
-//    - The copy assignment operator replaces the content of one Plan object with
-//      a deep copy of another Plan object. It ensures that the original memory
-//      is deallocated and new memory is allocated for the copy.
+//    - The copy assignment operator shares the other Plan's chunk table and
+//      releases this Plan's reference to its previous one.
 //
 // 5. Move Assignment Operator:
 //    - The move assignment operator transfers ownership of resources from another
 //      Plan object to the current Plan object. It efficiently transfers the
-//      formulas array and resets the other Plan's resources.
+//      chunk table and resets the other Plan's resources.
 //
 // 6. Destructor:
-//    - The destructor deallocates the memory used by the formulas array, ensuring
-//      that there are no memory leaks.
+//    - The destructor releases the chunk table; chunks no other Plan shares are
+//      destroyed, ensuring that there are no memory leaks.
 //
-// 7. Add:
-//    - The Add method adds a new formula to the end of the Plan. It checks if the
-//      current capacity is sufficient and resizes the array if necessary.
+// 7. Add / Emplace / Reserve:
+//    - The Add method adds a new formula to the end of the Plan. It starts a new
+//      chunk when the last one is full and clones the last chunk if shared.
+//    - Emplace constructs the formula in place, and Reserve sizes the chunk
+//      table ahead of a known number of additions.
 //
 // 8. Remove:
-//    - The Remove method removes the last formula from the Plan, effectively
-//      reducing its size.
+//    - The Remove method destroys the last formula in the Plan, reducing its
+//      size and releasing the formula's arrays immediately. A shared last chunk
+//      is cloned first, and a chunk left empty is dropped from the table.
 //
 // 9. Replace:
 //    - The Replace method replaces a formula at a specified index in the Plan. It
-//      performs bounds checking to ensure the index is valid.
+//      performs bounds checking to ensure the index is valid and clones at most
+//      the table and the one chunk holding the formula.
 //
-// 10. ResizeIfNeeded:
-//     - The ResizeIfNeeded method expands the capacity of the Plan when the current
-//       capacity is insufficient to hold more formulas. It dynamically adjusts the
-//       capacity and transfers existing formulas to the new memory.
+// 10. Copy-on-write:
+//     - MutableTable and MutableChunk clone only when another Plan holds a
+//       reference. A use count of one means no other Plan can reach the
+//       storage, so in-place mutation is safe.
 //
 // 11. DisplayFormulas:
 //     - The DisplayFormulas method generates a string containing information about
 //       all the formulas in the Plan. It handles cases where there are no formulas
 //       and formats the output with formula numbers and their respective results.
+//
+// 12. Compile:
+//     - The Compile method lazily builds a CompiledPlan and caches it. Every
+//       mutating method resets the cache, and copies share the cached,
+//       immutable CompiledPlan.
@@ -16,10 +16,16 @@
 // INVARIANTS:
 // - The Plan maintains an ordered collection of Formula objects, with operations
 //   to modify this collection (addition, removal, replacement).
-// - The internal storage scales dynamically with the collection size, ensuring
-//   efficient use of memory.
-// - Deep copy semantics ensure that copies of a Plan are entirely independent,
-//   with no shared Formulas between them.
+// - Formulas are stored in fixed-size chunks of ChunkSize elements, each
+//   constructed in place; slots past a chunk's count are uninitialized memory.
+// - Chunks and the chunk table are shared between copies of a Plan and are
+//   never modified while shared: a mutation first clones the table and the one
+//   chunk it touches, so copying a Plan is O(1) and copies still behave as
+//   entirely independent values. Different threads may each own and mutate
+//   their own copy; whether a chunk is still shared is checked with an
+//   acquire fence, so a mutation in place is ordered after every read by a
+//   copy that has since been destroyed.
+// - The chunks hold exactly 'size' Formulas in total, in Plan order.
 // - Move semantics provide efficient transfers of resources, particularly useful
 //   for temporary Plans or when reassigning Plans.
 // - Proper resource management is maintained throughout the Plan's lifecycle,
@@ -28,19 +34,79 @@
 #ifndef P2_PLAN_H
 #define P2_PLAN_H
 
+#include "compiledPlan.h"
 #include "formula.h"
+#include <memory>
+#include <new>
 #include <string>
+#include <utility>
+#include <vector>
 
 class Plan {
 private:
-    void ResizeIfNeeded();
-    // Ensures capacity to add new Formulas, resizing array if necessary.
+    static constexpr int ChunkShift = 6;
+    static constexpr int ChunkSize = 1 << ChunkShift;
+    static constexpr int ChunkMask = ChunkSize - 1;
+
+    class Chunk {
+    public:
+        Chunk() : count(0) {}
+        Chunk(const Chunk &other);
+        Chunk &operator=(const Chunk &) = delete;
+        ~Chunk();
+
+        Formula &operator[](int index) {
+            return *std::launder(reinterpret_cast<Formula *>(slots) + index);
+        }
+        const Formula &operator[](int index) const {
+            return *std::launder(reinterpret_cast<const Formula *>(slots) + index);
+        }
+
+        template <typename... Args>
+        Formula &Emplace(Args&&... args) {
+            Formula *formula = new (reinterpret_cast<Formula *>(slots) + count)
+                    Formula(std::forward<Args>(args)...);
+            ++count;
+            return *formula;
+        }
+
+        void PopBack();
+
+        int count; // Constructed Formulas, always the first 'count' slots.
+    private:
+        alignas(Formula) unsigned char slots[ChunkSize * sizeof(Formula)];
+    };
+    // A fixed-capacity block of Formulas constructed in place. Chunks are
+    // shared between Plan copies and treated as immutable while shared.
+
+    using ChunkTable = std::vector<std::shared_ptr<Chunk>>;
+
+    ChunkTable &MutableTable();
+    // Returns the chunk table, cloning it first if another Plan shares it.
     // Preconditions: None.
-    // Postconditions: Capacity increased if needed for additional Formulas.
+    // Postconditions: 'chunks' is non-null and owned by this Plan alone.
+
+    Chunk &MutableChunk(int chunkIndex);
+    // Returns a chunk, cloning it first if another Plan shares it.
+    // Preconditions: 0 <= chunkIndex < number of chunks.
+    // Postconditions: The chunk is owned by this Plan alone.
+
+    Chunk &AppendChunk();
+    // Returns the chunk that receives the next Formula, adding one if the
+    // last chunk is full.
+    // Preconditions: None.
+    // Postconditions: The returned chunk is unshared and has a free slot.
 protected:
-    Formula* formulas; // Pointer to dynamically allocated array of Formulas.
-    int size;          // Current number of Formulas in Plan.
-    int capacity;      // Capacity of the formulas array.
+    std::shared_ptr<ChunkTable> chunks; // Shared chunk table; null when empty.
+    int size;                           // Current number of Formulas in Plan.
+    // Cached compiled form; reset by every mutation so it never goes stale.
+    mutable std::shared_ptr<const CompiledPlan> compiled;
+
+    const Formula &FormulaAt(int index) const {
+        return (*(*chunks)[index >> ChunkShift])[index & ChunkMask];
+    }
+    // Unchecked access for the Plan and its subclasses.
+    // Preconditions: 0 <= index < size.
 public:
     Plan(Formula* initialFormulas, int initialSize);
     // Constructor initializes a Plan with an array of Formulas and their count.
@@ -49,9 +115,10 @@ public:
     // Postconditions: The Plan is initialized with the specified Formulas.
 
     Plan(const Plan& other);
-    // Copy constructor creates a deep copy of another Plan.
+    // Copy constructor shares another Plan's storage in O(1).
     // Preconditions: 'other' is a valid, existing Plan object.
-    // Postconditions: A new Plan object is a deep copy of 'other'.
+    // Postconditions: A new Plan equal to 'other'; later changes to either
+    //                 Plan do not affect the other.
 
     Plan(Plan&& other) noexcept;
     // Move constructor transfers ownership of resources from another Plan.
@@ -59,9 +126,9 @@ public:
     // Postconditions: The new Plan takes 'other's resources; 'other' is empty.
 
     Plan& operator=(const Plan& other);
-    // Copy assignment operator replaces this Plan with a deep copy of another.
+    // Copy assignment operator shares another Plan's storage in O(1).
     // Preconditions: 'other' is a valid Plan object.
-    // Postconditions: This Plan is a deep copy of 'other'.
+    // Postconditions: This Plan equals 'other' and stays independent of it.
 
     Plan& operator=(Plan&& other) noexcept;
     // Move assignment operator transfers resources from another Plan.
@@ -78,6 +145,23 @@ public:
     // Preconditions: 'formula' is a valid Formula object.
     // Postconditions: 'formula' is added; size is incremented by 1.
 
+    template <typename... Args>
+    Formula &Emplace(Args&&... args) {
+        Formula &formula = AppendChunk().Emplace(std::forward<Args>(args)...);
+        ++size;
+        compiled.reset();
+        return formula;
+    }
+    // Constructs a new Formula in place at the end of the Plan.
+    // Preconditions: 'args' match a Formula constructor.
+    // Postconditions: The formula is added; size is incremented by 1.
+
+    void Reserve(int newCapacity);
+    // Reserves the chunk table for at least 'newCapacity' Formulas.
+    // Preconditions: None.
+    // Postconditions: The next newCapacity - size additions do not grow the
+    //                 chunk table.
+
     void Remove();
     // Removes the last Formula from the Plan.
     // Preconditions: Plan is not empty (size > 0).
@@ -86,7 +170,22 @@ public:
     void Replace(int index, Formula&& formula);
     // Replaces a Formula at a specific index with a new one.
     // Preconditions: 'index' within bounds (0 <= index < size), 'formula' valid.
-    // Postconditions: Formula at 'index' is replaced with 'formula'.
+    // Postconditions: Formula at 'index' is replaced with 'formula'; at most
+    //                 one chunk is copied.
+
+    int GetSize() const;
+    // Returns the number of Formulas in the Plan.
+
+    const Formula &GetFormula(int index) const;
+    // Returns the Formula at a specific index.
+    // Preconditions: 'index' within bounds (0 <= index < size).
+    // Postconditions: Throws out_of_range otherwise.
+
+    std::shared_ptr<const CompiledPlan> Compile() const;
+    // Returns the compiled, immutable form of the Plan.
+    // Preconditions: Not called concurrently with itself or a mutation.
+    // Postconditions: Compiles on first use after a mutation; later calls
+    //                 share the same CompiledPlan.
 
     std::string DisplayFormulas() const;
     // Generates a string representation of all Formulas in the Plan.
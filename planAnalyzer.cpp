@@ -0,0 +1,97 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: planAnalyzer.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the PlanAnalyzer class.
+
+#include "planAnalyzer.h"
+#include "formula.h"
+#include "plan.h"
+#include "stockpile.h"
+#include <algorithm>
+#include <utility>
+
+PlanAnalyzer::PlanAnalyzer(const Plan &plan) : PlanAnalyzer(plan.Compile()) {}
+
+PlanAnalyzer::PlanAnalyzer(std::shared_ptr<const CompiledPlan> program)
+        : program(std::move(program)),
+          lowestTier(Formula::MaxProficiency + 1),
+          highestTier(Formula::MaxProficiency + 1) {
+    for (int level = 0; level <= Formula::MaxProficiency; ++level) {
+        double p[TierCount];
+        Formula::TierProbabilities(level, p);
+        int low = 0;
+        while (low < TierCount - 1 && p[low] == 0.0) {
+            ++low;
+        }
+        int high = TierCount - 1;
+        while (high > 0 && p[high] == 0.0) {
+            --high;
+        }
+        lowestTier[level] = static_cast<MultiplierTier>(low);
+        highestTier[level] = static_cast<MultiplierTier>(high);
+    }
+}
+
+// Analyze: Inputs are debited one term at a time, as Transact does, so a
+// resource named twice among a step's inputs is checked against the sum.
+PlanAnalysis PlanAnalyzer::Analyze(const Stockpile &initial) const {
+    const std::size_t bound =
+            std::max(program->GetResourceBound(), initial.GetResourceBound());
+    PlanAnalysis analysis{-1, InvalidResource, -1, std::vector<ResourceBounds>(bound)};
+    std::vector<std::int64_t> worst(bound);
+    std::vector<std::int64_t> best(bound);
+    std::vector<std::int64_t> lowWater(bound);
+    for (std::size_t id = 0; id < bound; ++id) {
+        worst[id] = initial.GetQuantity(static_cast<ResourceId>(id));
+    }
+    best = worst;
+    lowWater = worst;
+
+    for (int i = 0; i < program->GetSize(); ++i) {
+        CompiledFormula step = program->GetStep(i);
+        const int level = std::min(std::max(step.proficiencyLevel, 0),
+                                   Formula::MaxProficiency);
+        for (int k = 0; k < step.inputCount; ++k) {
+            const ResourceAmount &input = step.inputs[k];
+            const std::int64_t left = worst[input.id] -= input.quantity;
+            best[input.id] -= input.quantity;
+            lowWater[input.id] = std::min(lowWater[input.id], left);
+            if (left < 0 && analysis.firstRiskyStep < 0) {
+                analysis.firstRiskyStep = i;
+                analysis.riskyResource = input.id;
+            }
+            if (best[input.id] < 0 && analysis.firstFailingStep < 0) {
+                analysis.firstFailingStep = i;
+            }
+        }
+        const MultiplierTier least = lowestTier[level];
+        const MultiplierTier most = highestTier[level];
+        for (int k = 0; k < step.outputCount; ++k) {
+            const ResourceAmount &output = step.outputs[k];
+            worst[output.id] += AdjustQuantity(output.quantity, least);
+            best[output.id] += AdjustQuantity(output.quantity, most);
+        }
+    }
+
+    for (std::size_t id = 0; id < bound; ++id) {
+        const std::int64_t start = initial.GetQuantity(static_cast<ResourceId>(id));
+        analysis.resources[id] = ResourceBounds{static_cast<ResourceId>(id), worst[id],
+                                                best[id], lowWater[id],
+                                                start - lowWater[id]};
+    }
+    return analysis;
+}
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. lowWater[r] starts at the starting stock and is lowered right after
+//    each debit, so start - lowWater[r] is the deepest the worst
+//    trajectory falls below its start: exactly the stock that has to be
+//    there for it to stay non-negative, and never less than zero.
+// 2. Stock only falls at a debit, so checking right after each one finds
+//    the first shortfall of either trajectory.
+// 3. Trajectories of different resources never interact while every step
+//    applies, so each requiredStock is independent of the others.
+// 4. Every vector is sized to 'bound', which covers every ID the plan or
+//    the stockpile uses, so no lookup goes out of range.
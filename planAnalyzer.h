@@ -0,0 +1,78 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: planAnalyzer.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines PlanAnalyzer, a static feasibility and bottleneck
+//              pre-pass. One linear sweep over a compiled plan follows two
+//              trajectories of every resource: the worst case, where each
+//              step yields its lowest reachable tier, and the best case,
+//              where it yields its highest. No random draws are made and
+//              nothing is applied, so a plan that is bound to fail, or that
+//              might, is rejected before any work is spent on running it.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. Outputs never decrease with the tier and inputs do not depend on it,
+//    so as long as every earlier step applied, the stock a real run holds
+//    lies between the worst and best trajectories.
+// 2. Hence a step that the worst trajectory covers can never fail, and a
+//    step that the best trajectory does not cover always fails if it is
+//    reached. Between the two, the outcome depends on the draws.
+// 3. Tiers are reachable by their probability at the step's compiled
+//    proficiency level. Progression tracked by a ProficiencyTracker is not
+//    modelled.
+
+#ifndef PLANANALYZER_H
+#define PLANANALYZER_H
+
+#include "applyLog.h"
+#include "compiledPlan.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Plan;
+class Stockpile;
+
+struct ResourceBounds {
+    ResourceId id;
+    std::int64_t worst;         // Final quantity if every step yields its least
+    std::int64_t best;          // Final quantity if every step yields its most
+    std::int64_t lowWater;      // Lowest quantity along the worst trajectory
+    std::int64_t requiredStock; // Least starting stock that never runs short
+};
+
+struct PlanAnalysis {
+    int firstRiskyStep;       // First step that could fail, or -1
+    ResourceId riskyResource; // Input it could run short of, or InvalidResource
+    int firstFailingStep;     // First step that fails even at best, or -1
+    std::vector<ResourceBounds> resources; // Indexed by ResourceId
+
+    bool IsGuaranteed() const { return firstRiskyStep < 0; }
+    // True when the plan completes whatever the draws.
+};
+
+class PlanAnalyzer {
+public:
+    explicit PlanAnalyzer(const Plan &plan);
+    // Compiles 'plan' and tabulates the reachable tiers per proficiency level.
+
+    explicit PlanAnalyzer(std::shared_ptr<const CompiledPlan> program);
+    // Analyzes an already compiled plan, e.g. one returned by LoadPlan.
+    // Preconditions: 'program' is non-null.
+
+    PlanAnalysis Analyze(const Stockpile &initial) const;
+    // Sweeps the plan once from 'initial'. Both trajectories assume every
+    // step applied, so the sweep goes on past the first risky step, and
+    // requiredStock covers the whole plan.
+    // Preconditions: None.
+    // Postconditions: 'initial' is unchanged. Starting each resource at
+    //                 its requiredStock or more makes IsGuaranteed() true.
+
+private:
+    std::shared_ptr<const CompiledPlan> program;
+    std::vector<MultiplierTier> lowestTier;  // Per proficiency level
+    std::vector<MultiplierTier> highestTier; // Per proficiency level
+};
+
+#endif // PLANANALYZER_H
@@ -0,0 +1,397 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: planArchive.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the plan and stockpile archive format.
+
+#include "planArchive.h"
+#include "formula.h"
+#include "plan.h"
+#include "stockpile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PLANARCHIVE_HAS_MMAP 1
+#endif
+
+namespace {
+
+constexpr char ArchiveMagic[8] = {'R', 'T', 'S', 'A', 'R', 'C', 'H', '\0'};
+constexpr std::uint32_t ByteOrderMark = 0x01020304;
+
+enum class ArchiveKind : std::uint32_t {
+    Plan = 1,
+    Stockpile = 2
+};
+
+// Fixed-size header at offset 0. Section offsets are absolute and 8-byte
+// aligned; counts are in elements, not bytes.
+struct ArchiveHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t kind;
+    std::uint32_t nameCount;
+    std::uint64_t nameOffsets;    // uint32_t[nameCount + 1] into nameBytes
+    std::uint64_t nameBytes;      // Names back to back, not terminated
+    std::uint64_t recordCount;    // Steps, or quantities for a stockpile
+    std::uint64_t records;
+    std::uint64_t termCount;      // Zero for a stockpile
+    std::uint64_t terms;
+    std::uint32_t formulaIdCount; // Largest file-local formula identity
+    std::uint32_t reserved;
+};
+
+// The records are written and mapped as raw bytes, so their layout is part
+// of the format
+static_assert(sizeof(ArchiveHeader) == 80, "ArchiveHeader layout changed");
+static_assert(sizeof(CompiledStep) == 16, "CompiledStep layout changed");
+static_assert(sizeof(ResourceAmount) == 8, "ResourceAmount layout changed");
+static_assert(std::is_trivially_copyable<CompiledStep>::value &&
+              std::is_trivially_copyable<ResourceAmount>::value,
+              "Archive records must be trivially copyable");
+
+std::uint64_t AlignUp(std::uint64_t offset) {
+    return (offset + 7) & ~static_cast<std::uint64_t>(7);
+}
+
+// Assigns file-local IDs to process resource IDs in order of first use.
+class NameTable {
+public:
+    std::uint32_t LocalId(ResourceId id) {
+        if (id >= local.size()) {
+            local.resize(static_cast<std::size_t>(id) + 1, InvalidResource);
+        }
+        if (local[id] == InvalidResource) {
+            local[id] = static_cast<std::uint32_t>(ids.size());
+            ids.push_back(id);
+        }
+        return local[id];
+    }
+
+    const std::vector<ResourceId> &GetIds() const { return ids; }
+
+private:
+    std::vector<std::uint32_t> local; // Indexed by process ResourceId
+    std::vector<ResourceId> ids;      // Indexed by file-local ID
+};
+
+// WriteArchive: Lays out the header, name table, records and terms, padding
+// each section to an 8-byte boundary.
+void WriteArchive(const std::string &path, ArchiveKind kind,
+                  const NameTable &names, const void *records,
+                  std::uint64_t recordCount, std::size_t recordSize,
+                  const ResourceAmount *terms, std::uint64_t termCount,
+                  std::uint32_t formulaIdCount) {
+    const ResourceRegistry &registry = ResourceRegistry::Global();
+    std::vector<std::uint32_t> offsets;
+    std::string bytes;
+    offsets.reserve(names.GetIds().size() + 1);
+    offsets.push_back(0);
+    for (ResourceId id : names.GetIds()) {
+        bytes += registry.Name(id);
+        if (bytes.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error("Archive name table is too large");
+        }
+        offsets.push_back(static_cast<std::uint32_t>(bytes.size()));
+    }
+
+    ArchiveHeader header{};
+    std::memcpy(header.magic, ArchiveMagic, sizeof(ArchiveMagic));
+    header.version = ArchiveVersion;
+    header.byteOrder = ByteOrderMark;
+    header.kind = static_cast<std::uint32_t>(kind);
+    header.nameCount = static_cast<std::uint32_t>(names.GetIds().size());
+    header.nameOffsets = AlignUp(sizeof(ArchiveHeader));
+    header.nameBytes = AlignUp(header.nameOffsets +
+                               offsets.size() * sizeof(std::uint32_t));
+    header.recordCount = recordCount;
+    header.records = AlignUp(header.nameBytes + bytes.size());
+    header.termCount = termCount;
+    header.terms = AlignUp(header.records + recordCount * recordSize);
+    header.formulaIdCount = formulaIdCount;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open archive for writing: " + path);
+    }
+    std::uint64_t position = 0;
+    auto write = [&](std::uint64_t offset, const void *data, std::size_t size) {
+        static const char padding[8] = {};
+        out.write(padding, static_cast<std::streamsize>(offset - position));
+        out.write(static_cast<const char *>(data),
+                  static_cast<std::streamsize>(size));
+        position = offset + size;
+    };
+    write(0, &header, sizeof(header));
+    write(header.nameOffsets, offsets.data(),
+          offsets.size() * sizeof(std::uint32_t));
+    write(header.nameBytes, bytes.data(), bytes.size());
+    write(header.records, records, recordCount * recordSize);
+    write(header.terms, terms, termCount * sizeof(ResourceAmount));
+    if (!out.flush()) {
+        throw std::runtime_error("Cannot write archive: " + path);
+    }
+}
+
+// ReadHeader: Validates the fixed header of a mapped archive.
+const ArchiveHeader &ReadHeader(const MappedFile &file, ArchiveKind kind) {
+    if (file.GetSize() < sizeof(ArchiveHeader)) {
+        throw std::runtime_error("Archive is truncated");
+    }
+    const ArchiveHeader &header =
+            *reinterpret_cast<const ArchiveHeader *>(file.GetData());
+    if (std::memcmp(header.magic, ArchiveMagic, sizeof(ArchiveMagic)) != 0) {
+        throw std::runtime_error("Not a simulator archive");
+    }
+    if (header.byteOrder != ByteOrderMark) {
+        throw std::runtime_error("Archive was written with another byte order");
+    }
+    if (header.version != ArchiveVersion) {
+        throw std::runtime_error("Unsupported archive version " +
+                                 std::to_string(header.version));
+    }
+    if (header.kind != static_cast<std::uint32_t>(kind)) {
+        throw std::runtime_error("Archive holds a different kind of object");
+    }
+    return header;
+}
+
+// Section: Returns the 'count' elements at 'offset', checking that they lie
+// inside the file and are aligned for T.
+template <typename T>
+const T *Section(const MappedFile &file, std::uint64_t offset,
+                 std::uint64_t count) {
+    if (offset % 8 != 0 || offset > file.GetSize() ||
+        count > (file.GetSize() - offset) / sizeof(T)) {
+        throw std::runtime_error("Archive section out of range");
+    }
+    return reinterpret_cast<const T *>(file.GetData() + offset);
+}
+
+// InternNames: Interns every name of the table and returns the process ID
+// of each file-local ID.
+std::vector<ResourceId> InternNames(const MappedFile &file,
+                                    const ArchiveHeader &header) {
+    const std::uint32_t *offsets = Section<std::uint32_t>(
+            file, header.nameOffsets,
+            static_cast<std::uint64_t>(header.nameCount) + 1);
+    const char *bytes =
+            Section<char>(file, header.nameBytes, offsets[header.nameCount]);
+    ResourceRegistry &registry = ResourceRegistry::Global();
+    std::vector<ResourceId> ids(header.nameCount);
+    for (std::uint32_t i = 0; i < header.nameCount; ++i) {
+        if (offsets[i] > offsets[i + 1]) {
+            throw std::runtime_error("Archive name table is corrupt");
+        }
+        ids[i] = registry.Intern(
+                std::string_view(bytes + offsets[i], offsets[i + 1] - offsets[i]));
+    }
+    return ids;
+}
+
+// Keeps a mapped plan alive, together with any remapped copies of it.
+struct LoadedPlan {
+    std::shared_ptr<const MappedFile> file;
+    std::vector<CompiledStep> steps;
+    std::vector<ResourceAmount> terms;
+};
+
+} // namespace
+
+MappedFile::MappedFile(const std::string &path)
+        : data(nullptr), size(0), mapped(false) {
+#ifdef PLANARCHIVE_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open archive: " + path);
+    }
+    struct stat info{};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat archive: " + path);
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    if (size > 0) {
+        void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            data = static_cast<const unsigned char *>(address);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+    if (mapped || size == 0) {
+        return;
+    }
+#endif
+    // No mmap: read the whole file instead
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("Cannot open archive: " + path);
+    }
+    buffer.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(buffer.data()),
+            static_cast<std::streamsize>(buffer.size()));
+    if (!in) {
+        throw std::runtime_error("Cannot read archive: " + path);
+    }
+    data = buffer.data();
+    size = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef PLANARCHIVE_HAS_MMAP
+    if (mapped) {
+        ::munmap(const_cast<unsigned char *>(data), size);
+    }
+#endif
+}
+
+void SavePlan(const Plan &plan, const std::string &path) {
+    std::shared_ptr<const CompiledPlan> program = plan.Compile();
+    NameTable names;
+    std::vector<ResourceAmount> terms(program->GetTerms(),
+                                      program->GetTerms() +
+                                      program->GetTermCount());
+    for (ResourceAmount &term : terms) {
+        term.id = names.LocalId(term.id);
+    }
+
+    // Copies of a formula share its identity, so number identities, not steps
+    std::unordered_map<std::uint32_t, std::uint32_t> formulaIds;
+    std::vector<CompiledStep> steps(program->GetSteps(),
+                                    program->GetSteps() + program->GetSize());
+    for (CompiledStep &step : steps) {
+        if (step.formulaId != 0) {
+            auto inserted = formulaIds.emplace(
+                    step.formulaId,
+                    static_cast<std::uint32_t>(formulaIds.size() + 1));
+            step.formulaId = inserted.first->second;
+        }
+    }
+
+    WriteArchive(path, ArchiveKind::Plan, names, steps.data(), steps.size(),
+                 sizeof(CompiledStep), terms.data(), terms.size(),
+                 static_cast<std::uint32_t>(formulaIds.size()));
+}
+
+std::shared_ptr<const CompiledPlan> LoadPlan(const std::string &path) {
+    auto storage = std::make_shared<LoadedPlan>();
+    storage->file = std::make_shared<const MappedFile>(path);
+    const MappedFile &file = *storage->file;
+    const ArchiveHeader &header = ReadHeader(file, ArchiveKind::Plan);
+    const CompiledStep *steps =
+            Section<CompiledStep>(file, header.records, header.recordCount);
+    const ResourceAmount *terms =
+            Section<ResourceAmount>(file, header.terms, header.termCount);
+
+    std::vector<ResourceId> ids = InternNames(file, header);
+    bool sameIds = true;
+    for (std::uint32_t i = 0; i < header.nameCount; ++i) {
+        sameIds = sameIds && ids[i] == i;
+    }
+    if (!sameIds) {
+        storage->terms.assign(terms, terms + header.termCount);
+        for (ResourceAmount &term : storage->terms) {
+            if (term.id >= header.nameCount) {
+                throw std::runtime_error("Archive term names an unknown resource");
+            }
+            term.id = ids[term.id];
+        }
+        terms = storage->terms.data();
+    }
+
+    // File-local identities run from 1 to formulaIdCount, with 0 for none.
+    // Checked on every path: steps used in place must not carry IDs that
+    // live formulas could own.
+    for (std::uint64_t i = 0; i < header.recordCount; ++i) {
+        if (steps[i].formulaId > header.formulaIdCount) {
+            throw std::runtime_error("Archive step has an unknown formula");
+        }
+    }
+    std::uint32_t firstId = (header.formulaIdCount == 0)
+                            ? 1 : Formula::ReserveIds(header.formulaIdCount);
+    if (firstId != 1) {
+        storage->steps.assign(steps, steps + header.recordCount);
+        for (CompiledStep &step : storage->steps) {
+            if (step.formulaId != 0) {
+                step.formulaId += firstId - 1;
+            }
+        }
+        steps = storage->steps.data();
+    }
+
+    std::shared_ptr<const CompiledPlan> program;
+    try {
+        program = std::make_shared<const CompiledPlan>(
+                steps, header.recordCount, terms, header.termCount,
+                std::move(storage));
+    } catch (const std::invalid_argument &e) {
+        throw std::runtime_error(std::string("Archive is corrupt: ") + e.what());
+    }
+    if (sameIds && program->GetResourceBound() > header.nameCount) {
+        throw std::runtime_error("Archive term names an unknown resource");
+    }
+    return program;
+}
+
+void SaveStockpile(const Stockpile &stockpile, const std::string &path) {
+    NameTable names;
+    std::vector<std::int64_t> quantities;
+    for (std::size_t id = 0; id < stockpile.GetResourceBound(); ++id) {
+        std::int64_t quantity = stockpile.GetQuantity(static_cast<ResourceId>(id));
+        if (quantity != 0) {
+            names.LocalId(static_cast<ResourceId>(id));
+            quantities.push_back(quantity);
+        }
+    }
+    WriteArchive(path, ArchiveKind::Stockpile, names, quantities.data(),
+                 quantities.size(), sizeof(std::int64_t), nullptr, 0, 0);
+}
+
+void LoadStockpile(const std::string &path, Stockpile &stockpile) {
+    MappedFile file(path);
+    const ArchiveHeader &header = ReadHeader(file, ArchiveKind::Stockpile);
+    if (header.recordCount != header.nameCount) {
+        throw std::runtime_error("Archive quantities do not match its names");
+    }
+    const std::int64_t *quantities =
+            Section<std::int64_t>(file, header.records, header.recordCount);
+    std::vector<ResourceId> ids = InternNames(file, header);
+
+    std::size_t bound = 0;
+    for (ResourceId id : ids) {
+        bound = std::max(bound, static_cast<std::size_t>(id) + 1);
+    }
+    stockpile.Reserve(bound);
+    for (std::uint32_t i = 0; i < header.nameCount; ++i) {
+        stockpile.AddResource(ids[i], quantities[i]);
+    }
+}
+
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. Writers number resources and formula identities densely in order of
+//    first use, which is what lets a freshly started process map a plan
+//    archive without rewriting a single record.
+// 2. Loaders validate every offset and count against the file size before
+//    dereferencing it, and CompiledPlan validates every step against the
+//    term buffer, so a corrupt archive throws instead of reading out of
+//    bounds.
+// 3. A remap copies a whole section into one flat vector at most once; no
+//    load path allocates per formula.
+// 4. The CompiledPlan returned by LoadPlan owns the mapping through
+//    LoadedPlan, so the file stays mapped exactly as long as the plan lives.
@@ -0,0 +1,88 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: planArchive.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines a compact, versioned binary format for Plans and
+//              Stockpile snapshots. An archive holds a table of resource
+//              names followed by packed records in exactly the in-memory
+//              layout of CompiledPlan, so loading maps the file and points a
+//              CompiledPlan at it instead of parsing anything.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. Resource IDs inside an archive are file-local indices into its name
+//    table, numbered densely in order of first use. A process that interns
+//    the names in that order, e.g. one that loads the archive at startup,
+//    gets the same IDs and maps the terms without rewriting them.
+// 2. Formula identities inside an archive are file-local too, numbered
+//    densely from 1 (0 stays "no formula"); loading reserves a matching
+//    block with Formula::ReserveIds.
+// 3. Every section starts at an 8-byte aligned offset, and the file is
+//    written in native byte order, which the loader checks.
+// 4. A MappedFile's bytes never change and stay valid until the last
+//    shared_ptr to it is released.
+
+#ifndef PLANARCHIVE_H
+#define PLANARCHIVE_H
+
+#include "compiledPlan.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Plan;
+class Stockpile;
+
+// Read-only view of a whole file, memory-mapped where the platform allows.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    // Maps the file at 'path'.
+    // Preconditions: None.
+    // Postconditions: Throws std::runtime_error if it cannot be opened.
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    const unsigned char *GetData() const { return data; }
+    std::size_t GetSize() const { return size; }
+
+private:
+    const unsigned char *data;
+    std::size_t size;
+    bool mapped;                        // Whether 'data' came from mmap
+    std::vector<unsigned char> buffer;  // Fallback when mmap is unavailable
+};
+
+constexpr std::uint32_t ArchiveVersion = 1;
+
+void SavePlan(const Plan &plan, const std::string &path);
+// Writes the compiled form of 'plan' as a plan archive.
+// Preconditions: None.
+// Postconditions: Throws std::runtime_error if the file cannot be written.
+
+std::shared_ptr<const CompiledPlan> LoadPlan(const std::string &path);
+// Maps a plan archive and returns a CompiledPlan viewing it. Steps and
+// terms are used in place when the name table and formula identities line
+// up with this process (see invariants 1 and 2); otherwise they are
+// remapped once into two flat buffers. Either way, the load makes no
+// allocation per formula.
+// Preconditions: None.
+// Postconditions: Throws std::runtime_error for a missing, truncated,
+//                 corrupt or wrong-version archive.
+
+void SaveStockpile(const Stockpile &stockpile, const std::string &path);
+// Writes every resource quantity of 'stockpile'; the apply log is not saved.
+// Preconditions: None.
+// Postconditions: Throws std::runtime_error if the file cannot be written.
+
+void LoadStockpile(const std::string &path, Stockpile &stockpile);
+// Adds the quantities of a stockpile archive to 'stockpile', so loading
+// into an empty stockpile restores the snapshot.
+// Preconditions: None.
+// Postconditions: Throws std::runtime_error as LoadPlan does.
+
+#endif // PLANARCHIVE_H
@@ -0,0 +1,230 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: planScheduler.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the DependencyGraph and PlanScheduler classes.
+
+#include "planScheduler.h"
+#include "formula.h"
+#include "plan.h"
+#include "randomStream.h"
+#include "stockpile.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+DependencyGraph::DependencyGraph(const CompiledPlan &program) {
+    const int size = program.GetSize();
+    std::vector<int> lastTouch(program.GetResourceBound(), -1);
+    std::vector<int> marked(size, -1);
+    std::vector<std::pair<int, int>> edges;
+
+    predecessorCounts.assign(size, 0);
+    for (int step = 0; step < size; ++step) {
+        CompiledFormula formula = program.GetStep(step);
+        const int terms = formula.inputCount + formula.outputCount;
+        // Inputs and outputs are adjacent, so one loop covers both
+        for (int t = 0; t < terms; ++t) {
+            int previous = lastTouch[formula.inputs[t].id];
+            if (previous >= 0 && marked[previous] != step) {
+                marked[previous] = step;
+                edges.emplace_back(previous, step);
+                ++predecessorCounts[step];
+            }
+        }
+        for (int t = 0; t < terms; ++t) {
+            lastTouch[formula.inputs[t].id] = step;
+        }
+    }
+
+    // Counting sort of the edges by source into CSR form
+    successorOffsets.assign(size + 1, 0);
+    for (const auto &edge : edges) {
+        ++successorOffsets[edge.first + 1];
+    }
+    for (int step = 0; step < size; ++step) {
+        successorOffsets[step + 1] += successorOffsets[step];
+    }
+    successors.resize(edges.size());
+    std::vector<int> cursor(successorOffsets.begin(), successorOffsets.end() - 1);
+    for (const auto &edge : edges) {
+        successors[cursor[edge.first]++] = edge.second;
+    }
+}
+
+PlanScheduler::PlanScheduler(const Plan &plan)
+        : PlanScheduler(plan.Compile()) {}
+
+PlanScheduler::PlanScheduler(std::shared_ptr<const CompiledPlan> program)
+        : program(std::move(program)), graph(*this->program) {}
+
+namespace {
+
+// One resource per cache line so concurrent steps never false-share
+struct alignas(64) ResourceShard {
+    std::int64_t quantity;
+};
+
+struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<int> steps;
+};
+
+// Same contract as Stockpile::Transact, over the sharded slots
+bool TransactShards(ResourceShard *shards, const CompiledFormula &formula,
+                    MultiplierTier tier) {
+    for (int i = 0; i < formula.inputCount; ++i) {
+        const ResourceAmount &input = formula.inputs[i];
+        if (shards[input.id].quantity < input.quantity) {
+            while (i-- > 0) {
+                shards[formula.inputs[i].id].quantity += formula.inputs[i].quantity;
+            }
+            return false;
+        }
+        shards[input.id].quantity -= input.quantity;
+    }
+    for (int i = 0; i < formula.outputCount; ++i) {
+        shards[formula.outputs[i].id].quantity +=
+                AdjustQuantity(formula.outputs[i].quantity, tier);
+    }
+    return true;
+}
+
+void RevertShards(ResourceShard *shards, const CompiledFormula &formula,
+                  MultiplierTier tier) {
+    for (int i = 0; i < formula.outputCount; ++i) {
+        shards[formula.outputs[i].id].quantity -=
+                AdjustQuantity(formula.outputs[i].quantity, tier);
+    }
+    for (int i = 0; i < formula.inputCount; ++i) {
+        shards[formula.inputs[i].id].quantity += formula.inputs[i].quantity;
+    }
+}
+
+} // namespace
+
+RunResult PlanScheduler::Run(Stockpile &stockpile, std::uint64_t seed,
+                             int threads, bool record) const {
+    const int size = program->GetSize();
+    const std::size_t bound =
+            std::max(program->GetResourceBound(), stockpile.GetResourceBound());
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    threads = std::max(1, threads);
+
+    std::vector<ResourceShard> shards(bound);
+    for (std::size_t id = 0; id < bound; ++id) {
+        shards[id].quantity = stockpile.GetQuantity(static_cast<ResourceId>(id));
+    }
+
+    std::unique_ptr<std::atomic<int>[]> pending(new std::atomic<int>[size]);
+    std::vector<WorkQueue> queues(threads);
+    int roots = 0;
+    for (int step = 0; step < size; ++step) {
+        pending[step].store(graph.GetPredecessorCount(step), std::memory_order_relaxed);
+        if (graph.GetPredecessorCount(step) == 0) {
+            queues[roots++ % threads].steps.push_back(step);
+        }
+    }
+
+    // Each slot is written only by the worker that ran the step
+    std::vector<MultiplierTier> tiers(size, MultiplierTier::Zero);
+    std::vector<std::uint8_t> applied(size, 0);
+    std::atomic<int> inFlight(roots);       // Queued plus running steps
+    std::atomic<int> firstFailure(size);
+
+    auto take = [&](int self, int &step) {
+        for (int k = 0; k < threads; ++k) {
+            WorkQueue &queue = queues[(self + k) % threads];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.steps.empty()) {
+                // Own work comes from the back, stolen work from the front
+                if (k == 0) {
+                    step = queue.steps.back();
+                    queue.steps.pop_back();
+                } else {
+                    step = queue.steps.front();
+                    queue.steps.pop_front();
+                }
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto worker = [&](int self) {
+        while (inFlight.load(std::memory_order_acquire) > 0) {
+            int step;
+            if (!take(self, step)) {
+                std::this_thread::yield();
+                continue;
+            }
+            // Steps past a failure would be rolled back anyway
+            if (step < firstFailure.load(std::memory_order_relaxed)) {
+                CompiledFormula formula = program->GetStep(step);
+                RandomStream rng(seed, static_cast<std::uint64_t>(step));
+                MultiplierTier tier =
+                        Formula::DetermineMultiplier(formula.proficiencyLevel, rng);
+                if (TransactShards(shards.data(), formula, tier)) {
+                    tiers[step] = tier;
+                    applied[step] = 1;
+                    for (const int *s = graph.SuccessorsBegin(step);
+                         s != graph.SuccessorsEnd(step); ++s) {
+                        if (pending[*s].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                            inFlight.fetch_add(1, std::memory_order_relaxed);
+                            std::lock_guard<std::mutex> lock(queues[self].mutex);
+                            queues[self].steps.push_back(*s);
+                        }
+                    }
+                } else {
+                    int current = firstFailure.load(std::memory_order_relaxed);
+                    while (step < current &&
+                           !firstFailure.compare_exchange_weak(current, step)) {
+                    }
+                }
+            }
+            inFlight.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(worker, t);
+    }
+    worker(0);
+    for (std::thread &thread : workers) {
+        thread.join();
+    }
+
+    // Undo everything after the first failure, latest first
+    const int failed = firstFailure.load();
+    for (int step = size - 1; step > failed; --step) {
+        if (applied[step]) {
+            RevertShards(shards.data(), program->GetStep(step), tiers[step]);
+        }
+    }
+
+    stockpile.Reserve(bound);
+    for (std::size_t id = 0; id < bound; ++id) {
+        ResourceId resource = static_cast<ResourceId>(id);
+        stockpile.AddResource(resource,
+                              shards[id].quantity - stockpile.GetQuantity(resource));
+    }
+    if (record) {
+        const ApplyLog &log = stockpile.GetApplyLog();
+        stockpile.ReserveApplyLog(log.GetSize() + failed,
+                                  log.GetOutputTermCount() +
+                                  program->CountOutputTerms(0, failed));
+        for (int step = 0; step < failed; ++step) {
+            CompiledFormula formula = program->GetStep(step);
+            stockpile.StoreFormulaResult(
+                    ApplyRecord{static_cast<std::uint32_t>(step),
+                                formula.formulaId, tiers[step]}, formula);
+        }
+    }
+    return RunResult{failed, failed < size ? failed : -1};
+}
@@ -0,0 +1,88 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: planScheduler.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines DependencyGraph, a read/write dependency DAG over the
+//              steps of a compiled Plan, and PlanScheduler, a work-stealing
+//              executor that runs steps touching disjoint resources
+//              concurrently while producing exactly the final state of a
+//              sequential ExecutablePlan run with the same seed.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// DependencyGraph:
+// 1. Edges always point from a lower step index to a higher one.
+// 2. Step j depends on step i (i < j) whenever i is the last step before j
+//    that touches a resource j touches. Every step both reads and writes the
+//    resources it touches, so this captures all ordering constraints.
+//
+// PlanScheduler:
+// 1. Step i draws from RandomStream(seed, i), exactly like
+//    CompiledPlan::Execute, so outcomes do not depend on scheduling.
+// 2. Two steps only run concurrently if neither depends on the other, hence
+//    they never touch the same resource slot.
+// 3. If a step fails, every step after it is rolled back before Run returns,
+//    matching a sequential run that stops at the first failure.
+
+#ifndef PLANSCHEDULER_H
+#define PLANSCHEDULER_H
+
+#include "compiledPlan.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Plan;
+class Stockpile;
+
+class DependencyGraph {
+public:
+    explicit DependencyGraph(const CompiledPlan &program);
+    // Builds the DAG in one pass over the plan's terms.
+    // Preconditions: None.
+    // Postconditions: GetSize() == program.GetSize().
+
+    int GetSize() const { return static_cast<int>(predecessorCounts.size()); }
+    int GetEdgeCount() const { return static_cast<int>(successors.size()); }
+    int GetPredecessorCount(int step) const { return predecessorCounts[step]; }
+
+    const int *SuccessorsBegin(int step) const {
+        return successors.data() + successorOffsets[step];
+    }
+    const int *SuccessorsEnd(int step) const {
+        return successors.data() + successorOffsets[step + 1];
+    }
+    // Range of the steps that depend directly on 'step'.
+
+private:
+    std::vector<int> predecessorCounts;
+    std::vector<int> successorOffsets; // GetSize() + 1 entries
+    std::vector<int> successors;
+};
+
+class PlanScheduler {
+public:
+    explicit PlanScheduler(const Plan &plan);
+    // Compiles 'plan' and builds its dependency graph.
+
+    explicit PlanScheduler(std::shared_ptr<const CompiledPlan> program);
+    // Schedules an already compiled plan, e.g. one returned by LoadPlan.
+    // Preconditions: 'program' is non-null.
+
+    const DependencyGraph &GetGraph() const { return graph; }
+
+    RunResult Run(Stockpile &stockpile, std::uint64_t seed, int threads = 0,
+                  bool record = true) const;
+    // Runs every step on 'threads' workers (0 uses every hardware thread).
+    // Preconditions: Nothing else touches 'stockpile' during the call.
+    // Postconditions: 'stockpile' and the result equal those of an
+    //                 ExecutablePlan seeded with 'seed' and run to
+    //                 completion; when 'record' is set, the apply log gets
+    //                 the applied steps in plan order.
+
+private:
+    std::shared_ptr<const CompiledPlan> program;
+    DependencyGraph graph;
+};
+
+#endif // PLANSCHEDULER_H
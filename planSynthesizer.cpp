@@ -0,0 +1,445 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: planSynthesizer.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the PlanSynthesizer class.
+
+#include "planSynthesizer.h"
+#include "applyLog.h"
+#include "stockpile.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Pairs below this many per thread are not worth starting a thread for
+constexpr std::size_t MinPairsPerThread = 4096;
+
+// Hash of one state slot at one quantity. A state's hash is the sum over
+// its slots, so applying a formula updates it term by term.
+std::uint64_t TermHash(std::uint32_t slot, std::int64_t quantity) {
+    std::uint64_t z = (static_cast<std::uint64_t>(slot) << 32) ^
+                      static_cast<std::uint64_t>(quantity);
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+struct Node {
+    int parent;   // Node this one was reached from, or -1 for the start
+    int formula;  // Library index applied to the parent
+    int cost;     // Steps from the start along the best path found so far
+    bool expanded;
+};
+
+// Lowest estimated total first; among equals, the deeper state, then the
+// older one, which keeps the order independent of the thread count
+struct OpenEntry {
+    int total;
+    int cost;
+    int node;
+};
+
+bool Worse(const OpenEntry &a, const OpenEntry &b) {
+    if (a.total != b.total) {
+        return a.total > b.total;
+    }
+    if (a.cost != b.cost) {
+        return a.cost < b.cost;
+    }
+    return a.node > b.node;
+}
+
+// Open-addressing set of node indices, keyed by the nodes' state hashes
+class StateTable {
+public:
+    explicit StateTable(std::size_t bound) : bound(bound), slots(1024, -1) {}
+
+    // Returns the node holding 'state', or -1
+    int Find(const std::int64_t *state, std::uint64_t hash,
+             const std::vector<std::uint64_t> &hashes,
+             const std::vector<std::int64_t> &states) const {
+        const std::size_t mask = slots.size() - 1;
+        for (std::size_t i = hash & mask; slots[i] >= 0; i = (i + 1) & mask) {
+            const int node = slots[i];
+            if (hashes[node] == hash &&
+                std::memcmp(states.data() + node * bound, state, bound * sizeof(std::int64_t)) == 0) {
+                return node;
+            }
+        }
+        return -1;
+    }
+
+    void Insert(int node, const std::vector<std::uint64_t> &hashes) {
+        if (2 * (count + 1) > slots.size()) {
+            std::vector<int> old(slots.size() * 2, -1);
+            old.swap(slots);
+            count = 0;
+            for (int entry : old) {
+                if (entry >= 0) {
+                    Place(entry, hashes[entry]);
+                }
+            }
+        }
+        Place(node, hashes[node]);
+    }
+
+private:
+    void Place(int node, std::uint64_t hash) {
+        const std::size_t mask = slots.size() - 1;
+        std::size_t i = hash & mask;
+        while (slots[i] >= 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = node;
+        ++count;
+    }
+
+    std::size_t bound;
+    std::vector<int> slots; // Power-of-two size, at most half full
+    std::size_t count = 0;
+};
+
+} // namespace
+
+PlanSynthesizer::PlanSynthesizer(const std::vector<Formula> &library,
+                                 const SynthesisOptions &options)
+        : library(library), options(options) {
+    if (options.batchSize <= 0) {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+    Plan plan(nullptr, 0);
+    for (const Formula &formula : library) {
+        plan.Add(Formula(formula));
+    }
+    program = plan.Compile();
+
+    // The tier each formula is planned at, per proficiency level
+    std::vector<MultiplierTier> planned(Formula::MaxProficiency + 1, MultiplierTier::Standard);
+    if (options.worstCase) {
+        for (int level = 0; level <= Formula::MaxProficiency; ++level) {
+            double p[TierCount];
+            Formula::TierProbabilities(level, p);
+            int low = 0;
+            while (low < TierCount - 1 && p[low] == 0.0) {
+                ++low;
+            }
+            planned[level] = static_cast<MultiplierTier>(low);
+        }
+    }
+
+    // States only hold the resources some formula touches; the rest never
+    // change, so slots are assigned to those alone, in ascending ID order
+    slotOf.assign(program->GetResourceBound(), -1);
+    for (int f = 0; f < program->GetSize(); ++f) {
+        CompiledFormula step = program->GetStep(f);
+        for (int k = 0; k < step.inputCount; ++k) {
+            slotOf[step.inputs[k].id] = 0;
+        }
+        for (int k = 0; k < step.outputCount; ++k) {
+            slotOf[step.outputs[k].id] = 0;
+        }
+    }
+    for (std::size_t id = 0; id < slotOf.size(); ++id) {
+        if (slotOf[id] == 0) {
+            slotOf[id] = static_cast<int>(resources.size());
+            resources.push_back(static_cast<ResourceId>(id));
+        }
+    }
+
+    std::vector<std::int64_t> net(resources.size(), 0);
+    std::vector<std::uint32_t> touched;
+    needBegin.push_back(0);
+    deltaBegin.push_back(0);
+    for (int f = 0; f < program->GetSize(); ++f) {
+        CompiledFormula step = program->GetStep(f);
+        const int level = std::min(std::max(step.proficiencyLevel, 0),
+                                   Formula::MaxProficiency);
+        // Inputs named twice must be covered by their sum, as in Transact
+        for (int k = 0; k < step.inputCount; ++k) {
+            const std::uint32_t slot = slotOf[step.inputs[k].id];
+            const std::int64_t quantity = step.inputs[k].quantity;
+            auto merged = std::find_if(needs.begin() + needBegin[f], needs.end(),
+                                       [&](const Term &term) { return term.slot == slot; });
+            if (merged != needs.end()) {
+                merged->quantity += quantity;
+            } else {
+                needs.push_back(Term{slot, quantity});
+            }
+            if (std::find(touched.begin(), touched.end(), slot) == touched.end()) {
+                touched.push_back(slot);
+            }
+            net[slot] -= quantity;
+        }
+        for (int k = 0; k < step.outputCount; ++k) {
+            const std::uint32_t slot = slotOf[step.outputs[k].id];
+            if (std::find(touched.begin(), touched.end(), slot) == touched.end()) {
+                touched.push_back(slot);
+            }
+            net[slot] += AdjustQuantity(step.outputs[k].quantity, planned[level]);
+        }
+        for (std::uint32_t slot : touched) {
+            if (net[slot] != 0) {
+                deltas.push_back(Term{slot, net[slot]});
+                net[slot] = 0;
+            }
+        }
+        touched.clear();
+        needBegin.push_back(needs.size());
+        deltaBegin.push_back(deltas.size());
+    }
+}
+
+int PlanSynthesizer::Estimate(const std::int64_t *state, const Round &round,
+                              int formula) {
+    const std::vector<Term> &targets = *round.targets;
+    const std::size_t targetCount = targets.size();
+    int estimate = 0;
+    for (std::size_t t = 0; t < targetCount; ++t) {
+        std::int64_t quantity = state[targets[t].slot];
+        if (formula >= 0) {
+            quantity += (*round.targetGains)[formula * targetCount + t];
+        }
+        const std::int64_t shortfall = targets[t].quantity - quantity;
+        if (shortfall <= 0) {
+            continue;
+        }
+        const std::int64_t gain = (*round.bestGains)[t];
+        if (gain <= 0) {
+            return -1;
+        }
+        estimate = std::max(estimate, static_cast<int>((shortfall + gain - 1) / gain));
+    }
+    return estimate;
+}
+
+// Expand: Checks each formula against the parent's stock, then derives the
+// successor's hash and heuristic from the formula's net changes alone, so
+// threads never copy a state; the merge writes out the quantities.
+void PlanSynthesizer::Expand(const Round &round, std::size_t begin,
+                             std::size_t end, std::vector<Successor> &out) const {
+    const std::size_t formulas = library.size();
+    for (std::size_t pair = begin; pair < end; ++pair) {
+        const int parent = (*round.batch)[pair / formulas];
+        const int f = static_cast<int>(pair % formulas);
+        const std::int64_t *state = round.states + static_cast<std::size_t>(parent) * round.bound;
+        bool applicable = true;
+        for (std::size_t k = needBegin[f]; k < needBegin[f + 1] && applicable; ++k) {
+            applicable = state[needs[k].slot] >= needs[k].quantity;
+        }
+        if (!applicable) {
+            continue;
+        }
+        const int estimate = Estimate(state, round, f);
+        if (estimate < 0) {
+            continue;
+        }
+        std::uint64_t hash = round.hashes[parent];
+        for (std::size_t k = deltaBegin[f]; k < deltaBegin[f + 1]; ++k) {
+            const std::int64_t before = state[deltas[k].slot];
+            hash += TermHash(deltas[k].slot, before + deltas[k].quantity) -
+                    TermHash(deltas[k].slot, before);
+        }
+        out.push_back(Successor{parent, f, estimate, hash});
+    }
+}
+
+SynthesisResult PlanSynthesizer::Search(const Stockpile &initial,
+                                        const Stockpile &target) const {
+    const std::size_t bound = resources.size();
+    const std::size_t formulas = library.size();
+    SynthesisResult result{false, true, {}, 0, 0};
+
+    // A target no formula touches is met from the start or never
+    std::vector<Term> targets;
+    for (std::size_t id = 0; id < target.GetResourceBound(); ++id) {
+        const std::int64_t quantity = target.GetQuantity(static_cast<ResourceId>(id));
+        if (quantity <= 0) {
+            continue;
+        }
+        if (id < slotOf.size() && slotOf[id] >= 0) {
+            targets.push_back(Term{static_cast<std::uint32_t>(slotOf[id]), quantity});
+        } else if (initial.GetQuantity(static_cast<ResourceId>(id)) < quantity) {
+            return result;
+        }
+    }
+    // Net change of every target per formula, and the largest of them
+    std::vector<std::int64_t> targetGains(formulas * targets.size(), 0);
+    std::vector<std::int64_t> bestGains(targets.size(), 0);
+    for (std::size_t f = 0; f < formulas; ++f) {
+        for (std::size_t k = deltaBegin[f]; k < deltaBegin[f + 1]; ++k) {
+            for (std::size_t t = 0; t < targets.size(); ++t) {
+                if (targets[t].slot == deltas[k].slot) {
+                    targetGains[f * targets.size() + t] = deltas[k].quantity;
+                    bestGains[t] = std::max(bestGains[t], deltas[k].quantity);
+                }
+            }
+        }
+    }
+
+    std::vector<Node> nodes;
+    std::vector<std::uint64_t> hashes;
+    std::vector<std::int64_t> states(bound);
+    std::uint64_t startHash = 0;
+    for (std::size_t slot = 0; slot < bound; ++slot) {
+        states[slot] = initial.GetQuantity(resources[slot]);
+        startHash += TermHash(static_cast<std::uint32_t>(slot), states[slot]);
+    }
+    nodes.push_back(Node{-1, -1, 0, false});
+    hashes.push_back(startHash);
+    StateTable table(bound);
+    table.Insert(0, hashes);
+
+    Round round{nullptr, bound, nullptr, nullptr, &targets, &targetGains, &bestGains};
+    const int startEstimate = Estimate(states.data(), round, -1);
+    if (startEstimate < 0) {
+        return result; // Some target can never grow
+    }
+    std::vector<OpenEntry> open{OpenEntry{startEstimate, 0, 0}};
+
+    int threads = options.threads > 0
+                  ? options.threads
+                  : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::max(1, threads);
+    std::vector<std::vector<Successor>> successors(threads);
+    std::vector<int> batch;
+
+    while (!open.empty()) {
+        // Pop the best open states; a goal is only taken when it leads
+        batch.clear();
+        int goal = -1;
+        while (!open.empty() && batch.size() < static_cast<std::size_t>(options.batchSize)) {
+            std::pop_heap(open.begin(), open.end(), Worse);
+            OpenEntry entry = open.back();
+            open.pop_back();
+            Node &node = nodes[entry.node];
+            if (node.expanded || entry.cost != node.cost) {
+                continue; // Stale: expanded, or since reached more cheaply
+            }
+            if (entry.total == entry.cost) {
+                if (batch.empty()) {
+                    goal = entry.node;
+                } else {
+                    open.push_back(entry);
+                    std::push_heap(open.begin(), open.end(), Worse);
+                }
+                break;
+            }
+            node.expanded = true;
+            batch.push_back(entry.node);
+        }
+        if (goal >= 0) {
+            for (int n = goal; nodes[n].parent >= 0; n = nodes[n].parent) {
+                result.steps.push_back(nodes[n].formula);
+            }
+            std::reverse(result.steps.begin(), result.steps.end());
+            result.found = true;
+            return result;
+        }
+        if (batch.empty()) {
+            continue;
+        }
+        result.expanded += batch.size();
+
+        // Expand every (state, formula) pair, split into contiguous blocks
+        round.states = states.data();
+        round.batch = &batch;
+        round.hashes = hashes.data();
+        const std::size_t pairs = batch.size() * formulas;
+        const int workers = static_cast<int>(std::max<std::size_t>(1, std::min<std::size_t>(
+                static_cast<std::size_t>(threads), pairs / MinPairsPerThread)));
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (int t = 0; t < workers; ++t) {
+            std::size_t begin = pairs * t / workers;
+            std::size_t end = pairs * (t + 1) / workers;
+            successors[t].clear();
+            if (t == workers - 1) {
+                Expand(round, begin, end, successors[t]);
+            } else {
+                pool.emplace_back(&PlanSynthesizer::Expand, this, std::cref(round),
+                                  begin, end, std::ref(successors[t]));
+            }
+        }
+        for (std::thread &worker : pool) {
+            worker.join();
+        }
+
+        // Merge in block order, which is the order one thread would use
+        for (int t = 0; t < workers; ++t) {
+            result.generated += successors[t].size();
+            for (const Successor &successor : successors[t]) {
+                const int cost = nodes[successor.parent].cost + 1;
+                // Write the successor's state at the end of the arena
+                const std::size_t offset = states.size();
+                states.resize(offset + bound);
+                std::memcpy(states.data() + offset, states.data() + successor.parent * bound,
+                            bound * sizeof(std::int64_t));
+                for (std::size_t k = deltaBegin[successor.formula];
+                     k < deltaBegin[successor.formula + 1]; ++k) {
+                    states[offset + deltas[k].slot] += deltas[k].quantity;
+                }
+                int node = table.Find(states.data() + offset, successor.hash, hashes, states);
+                if (node >= 0) {
+                    states.resize(offset);
+                    if (cost >= nodes[node].cost) {
+                        continue;
+                    }
+                    nodes[node] = Node{successor.parent, successor.formula, cost, false};
+                } else if (nodes.size() >= options.maxStates) {
+                    states.resize(offset);
+                    result.optimal = false;
+                    continue;
+                } else {
+                    node = static_cast<int>(nodes.size());
+                    nodes.push_back(Node{successor.parent, successor.formula, cost, false});
+                    hashes.push_back(successor.hash);
+                    table.Insert(node, hashes);
+                }
+                open.push_back(OpenEntry{cost + successor.estimate, cost, node});
+                std::push_heap(open.begin(), open.end(), Worse);
+            }
+        }
+
+        // Keep the best three quarters of the bound when the open list
+        // outgrows it
+        if (open.size() > options.maxOpen) {
+            const std::size_t keep = std::max<std::size_t>(1, options.maxOpen * 3 / 4);
+            std::nth_element(open.begin(), open.begin() + keep, open.end(),
+                             [](const OpenEntry &a, const OpenEntry &b) { return Worse(b, a); });
+            open.resize(keep);
+            std::make_heap(open.begin(), open.end(), Worse);
+            result.optimal = false;
+        }
+    }
+    return result;
+}
+
+Plan PlanSynthesizer::BuildPlan(const SynthesisResult &result) const {
+    Plan plan(nullptr, 0);
+    for (int f : result.steps) {
+        plan.Add(Formula(library.at(f)));
+    }
+    return plan;
+}
+
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. Node n's quantities are states[n * bound, (n + 1) * bound), one per
+//    slot, hashes[n] is the sum of their TermHashes, and the table holds
+//    every node once. Slot s holds resources[s], and slotOf maps back.
+// 2. Expansion threads only read the arena, the hashes and the batch; the
+//    merge that writes them runs after every thread has joined.
+// 3. An open entry is live only while its cost matches its node's and the
+//    node is unexpanded. A cheaper path to a node updates it in place and
+//    reopens it, so a node is expanded once per cost it is reached at.
+// 4. A goal is returned only when popped first in its round, when no open
+//    entry has a lower total; successors of states popped alongside it
+//    could otherwise still undercut it.
+// 5. Every new state is hashed from its parent's hash before its
+//    quantities exist; the full comparison in Find guards against the
+//    rare collision.
@@ -0,0 +1,129 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: planSynthesizer.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines PlanSynthesizer, which searches for the shortest Plan
+//              that takes a starting Stockpile to at least a set of target
+//              quantities, using formulas from a fixed library. The search
+//              is A* over dense quantity vectors that hold only the
+//              resources some library formula touches. Each round, a batch
+//              of the best open states is expanded against every formula by
+//              several threads at once. The results are then merged in a
+//              fixed order into a hashed table of the states seen so far.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. Formulas are applied at the yield the options fix for them: the
+//    quantities as written, or in the worst case the lowest tier their
+//    proficiency level can draw. A worst-case plan therefore reaches the
+//    targets whatever the draws; otherwise only on average.
+// 2. The heuristic is the largest, over the targets, of the shortfall
+//    divided by the most any one formula adds of that resource, rounded
+//    up. No step closes more than that, so the heuristic never
+//    overestimates, and it drops by at most one per step.
+// 3. Successors are merged in the order a single thread would produce
+//    them, so the plan found does not depend on the thread count.
+// 4. The library never changes after construction; Search is safe to call
+//    from several threads at once.
+
+#ifndef PLANSYNTHESIZER_H
+#define PLANSYNTHESIZER_H
+
+#include "compiledPlan.h"
+#include "formula.h"
+#include "plan.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Stockpile;
+
+struct SynthesisOptions {
+    int threads = 0;                 // 0 uses every hardware thread
+    int batchSize = 64;              // Open states expanded per round
+    std::size_t maxStates = 1 << 20; // States kept before new ones are dropped;
+                                     // each takes 8 bytes per resource the
+                                     // library touches
+    std::size_t maxOpen = 1 << 18;   // Open-list entries kept before trimming
+    bool worstCase = false;          // Plan with the lowest reachable tiers
+};
+
+struct SynthesisResult {
+    bool found;
+    bool optimal;            // No state was dropped, so no plan is shorter
+    std::vector<int> steps;  // Library indices, in plan order
+    std::size_t expanded;    // States expanded
+    std::size_t generated;   // Successors produced, duplicates included
+};
+
+class PlanSynthesizer {
+public:
+    PlanSynthesizer(const std::vector<Formula> &library,
+                    const SynthesisOptions &options = SynthesisOptions());
+    // Copies and compiles 'library' once for every search.
+    // Preconditions: options.batchSize > 0.
+    // Postconditions: Throws std::invalid_argument otherwise.
+
+    SynthesisResult Search(const Stockpile &initial, const Stockpile &target) const;
+    // Searches for the fewest steps after which every resource holds at
+    // least its quantity in 'target'. Resources 'target' does not hold
+    // are unconstrained.
+    // Preconditions: None.
+    // Postconditions: 'initial' and 'target' are unchanged. found is false
+    //                 when no plan exists or none was found within the
+    //                 memory bounds; optimal is false when a bound dropped
+    //                 a state, as the plan found may then be longer than
+    //                 needed.
+
+    Plan BuildPlan(const SynthesisResult &result) const;
+    // Returns the plan result.steps describes.
+    // Preconditions: 'result' came from this synthesizer.
+
+    int GetLibrarySize() const { return static_cast<int>(library.size()); }
+
+private:
+    struct Term {
+        std::uint32_t slot; // Index into a state, not a ResourceId
+        std::int64_t quantity;
+    };
+
+    // One state reached from an expanded one by one more formula
+    struct Successor {
+        int parent;
+        int formula;
+        int estimate; // Heuristic of the new state
+        std::uint64_t hash;
+    };
+
+    // What the expansion threads share for one round
+    struct Round {
+        const std::int64_t *states;     // Arena of every stored state
+        std::size_t bound;              // Slots per state
+        const std::vector<int> *batch;  // States to expand
+        const std::uint64_t *hashes;    // Per stored state
+        const std::vector<Term> *targets;
+        const std::vector<std::int64_t> *targetGains; // Per formula, per target
+        const std::vector<std::int64_t> *bestGains;   // Per target
+    };
+
+    void Expand(const Round &round, std::size_t begin, std::size_t end,
+                std::vector<Successor> &out) const;
+    // Expands pairs [begin, end) of (batch state, formula), in that order.
+
+    static int Estimate(const std::int64_t *state, const Round &round, int formula);
+    // Heuristic of 'state' after 'formula', or of 'state' itself when
+    // 'formula' is negative; -1 when some target is out of reach.
+
+    std::vector<Formula> library;
+    SynthesisOptions options;
+    std::shared_ptr<const CompiledPlan> program; // Step i is library[i]
+    std::vector<ResourceId> resources;   // Resource held in each state slot
+    std::vector<int> slotOf;             // Slot per ResourceId, -1 if untouched
+    std::vector<std::size_t> needBegin;  // needs[needBegin[f], needBegin[f + 1])
+    std::vector<Term> needs;             // Inputs merged by resource
+    std::vector<std::size_t> deltaBegin; // deltas[deltaBegin[f], deltaBegin[f + 1])
+    std::vector<Term> deltas;            // Non-zero net changes by resource
+};
+
+#endif // PLANSYNTHESIZER_H
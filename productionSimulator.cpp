@@ -0,0 +1,153 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: productionSimulator.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the ProductionSimulator class.
+
+#include "productionSimulator.h"
+#include "formula.h"
+#include "plan.h"
+#include "randomStream.h"
+#include "stockpile.h"
+#include <stdexcept>
+#include <utility>
+
+ProductionSimulator::ProductionSimulator(const Plan &plan)
+        : ProductionSimulator(plan.Compile()) {}
+
+ProductionSimulator::ProductionSimulator(std::shared_ptr<const CompiledPlan> program)
+        : program(std::move(program)), machines(1, 1), defaultTiming{0, 1} {}
+
+int ProductionSimulator::AddPool(int machineCount) {
+    if (machineCount <= 0) {
+        throw std::invalid_argument("A machine pool needs at least one machine");
+    }
+    machines.push_back(machineCount);
+    return static_cast<int>(machines.size()) - 1;
+}
+
+void ProductionSimulator::SetMachines(int pool, int machineCount) {
+    CheckPool(pool);
+    if (machineCount <= 0) {
+        throw std::invalid_argument("A machine pool needs at least one machine");
+    }
+    machines[pool] = machineCount;
+}
+
+void ProductionSimulator::SetTiming(std::uint32_t formulaId, int pool,
+                                    std::uint64_t duration) {
+    CheckPool(pool);
+    timings[formulaId] = Timing{pool, duration};
+}
+
+void ProductionSimulator::SetDefaultTiming(int pool, std::uint64_t duration) {
+    CheckPool(pool);
+    defaultTiming = Timing{pool, duration};
+}
+
+// Run: Alternates between starting every step it can at the current time,
+// in plan order, and advancing the clock to the next completion time,
+// finishing every step that completes then before starting more.
+ProductionReport ProductionSimulator::Run(Stockpile &stockpile, std::uint64_t seed,
+                                          bool record, std::uint64_t stepBase) const {
+    const int size = program->GetSize();
+    // Resolve each step's timing once, not once per event
+    std::vector<Timing> stepTimings(size);
+    for (int i = 0; i < size; ++i) {
+        auto it = timings.find(program->GetStep(i).formulaId);
+        stepTimings[i] = (it != timings.end()) ? it->second : defaultTiming;
+    }
+
+    ProductionReport report{0, 0, -1, 0, std::vector<std::uint64_t>(machines.size(), 0),
+                            std::vector<double>(machines.size(), 0.0)};
+    std::vector<int> idle = machines;
+    std::vector<MultiplierTier> tiers(size);
+    EventQueue pending;
+    std::size_t totalMachines = 0;
+    for (int count : machines) {
+        totalMachines += static_cast<std::size_t>(count);
+    }
+    pending.Reserve(totalMachines);
+    stockpile.Reserve(program->GetResourceBound());
+    if (record) {
+        const ApplyLog &log = stockpile.GetApplyLog();
+        stockpile.ReserveApplyLog(log.GetSize() + size,
+                                  log.GetOutputTermCount() +
+                                  program->CountOutputTerms(0, size));
+    }
+
+    std::uint64_t now = 0;
+    int next = 0;
+    for (;;) {
+        while (next < size && idle[stepTimings[next].pool] > 0) {
+            CompiledFormula step = program->GetStep(next);
+            // Debit the inputs now; the outputs arrive on completion
+            CompiledFormula inputs{step.inputs, step.inputCount, step.outputs, 0,
+                                   step.proficiencyLevel, step.formulaId};
+            RandomStream rng(seed, stepBase + static_cast<std::uint64_t>(next));
+            MultiplierTier tier = Formula::DetermineMultiplier(step.proficiencyLevel, rng);
+            if (!stockpile.Transact(inputs, tier)) {
+                break;
+            }
+            const Timing &timing = stepTimings[next];
+            tiers[next] = tier;
+            --idle[timing.pool];
+            report.busyTime[timing.pool] += timing.duration;
+            pending.Push(Event{now + timing.duration, static_cast<std::uint32_t>(next),
+                               static_cast<std::uint32_t>(timing.pool)});
+            ++next;
+        }
+        if (pending.IsEmpty()) {
+            // Nothing running could supply the next step
+            report.blockedStep = (next < size) ? next : -1;
+            break;
+        }
+        now = pending.Top().time;
+        do {
+            Event done = pending.Pop();
+            CompiledFormula step = program->GetStep(static_cast<int>(done.step));
+            // Credit-only view; inputs points at the outputs for journaling
+            CompiledFormula outputs{step.outputs, 0, step.outputs, step.outputCount,
+                                    step.proficiencyLevel, step.formulaId};
+            stockpile.Transact(outputs, tiers[done.step]);
+            if (record) {
+                stockpile.StoreFormulaResult(
+                        ApplyRecord{static_cast<std::uint32_t>(stepBase + done.step),
+                                    step.formulaId, tiers[done.step]}, step);
+            }
+            ++idle[done.pool];
+            ++report.stepsCompleted;
+            ++report.events;
+        } while (!pending.IsEmpty() && pending.Top().time == now);
+    }
+
+    report.makespan = now;
+    for (std::size_t pool = 0; pool < machines.size(); ++pool) {
+        if (report.makespan > 0) {
+            report.utilization[pool] =
+                    static_cast<double>(report.busyTime[pool]) /
+                    (static_cast<double>(machines[pool]) * static_cast<double>(report.makespan));
+        }
+    }
+    return report;
+}
+
+void ProductionSimulator::CheckPool(int pool) const {
+    if (pool < 0 || pool >= GetPoolCount()) {
+        throw std::out_of_range("Unknown machine pool");
+    }
+}
+
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. idle[p] plus the pending events on pool p always equals machines[p],
+//    so the queue never holds more events than there are machines and
+//    Reserve(totalMachines) means Push never reallocates.
+// 2. 'now' never decreases: events are only pushed at now + duration and
+//    only popped earliest first.
+// 3. All completions at one time are processed before any step starts at
+//    that time, so a step sees every output available at its start time.
+// 4. A step blocked on inputs with no event pending stays blocked forever,
+//    as nothing else changes the stockpile, which is why the run stops
+//    there.
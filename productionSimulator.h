@@ -0,0 +1,99 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: productionSimulator.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines ProductionSimulator, a discrete-event model of
+//              running a Plan on real equipment. Every formula takes a
+//              duration and occupies one machine of a pool while it runs.
+//              Steps start in plan order as soon as a machine of their pool
+//              is free and their inputs are in stock. Inputs are consumed
+//              when a step starts and outputs arrive when it completes, so
+//              a step can wait on the output of one still running. Pending
+//              completions live in an EventQueue.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. Pool 0 always exists. Formulas without their own timing run on the
+//    default pool for the default duration.
+// 2. Step i draws its tier from RandomStream(seed, stepBase + i), as every
+//    other executor does. Timing only changes when steps run, never
+//    whether they do: whatever the pools and durations, a run completes
+//    the same steps and ends with the same stockpile as
+//    CompiledPlan::Execute.
+// 3. Steps start in plan order: a step never starts before the one ahead
+//    of it, even if it could.
+
+#ifndef PRODUCTIONSIMULATOR_H
+#define PRODUCTIONSIMULATOR_H
+
+#include "compiledPlan.h"
+#include "eventQueue.h"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class Plan;
+class Stockpile;
+
+// Outcome of a production run.
+struct ProductionReport {
+    std::uint64_t makespan;    // Time the last started step completed
+    int stepsCompleted;        // Steps that ran to completion
+    int blockedStep;           // Step whose inputs never arrived, or -1
+    std::uint64_t events;      // Completion events processed
+    std::vector<std::uint64_t> busyTime; // Machine-time used, per pool
+    std::vector<double> utilization;     // busyTime / (machines * makespan)
+};
+
+class ProductionSimulator {
+public:
+    explicit ProductionSimulator(const Plan &plan);
+    explicit ProductionSimulator(std::shared_ptr<const CompiledPlan> program);
+    // Compiles 'plan' once, or shares an already compiled one, with one
+    // pool of a single machine and a default duration of 1.
+    // Preconditions: None.
+
+    int AddPool(int machines);
+    // Adds a pool of 'machines' identical machines and returns its index.
+    // Preconditions: machines > 0.
+    // Postconditions: Throws std::invalid_argument otherwise.
+
+    void SetMachines(int pool, int machines);
+    // Changes the size of an existing pool, e.g. of the default pool 0.
+    // Preconditions: 0 <= pool < GetPoolCount(); machines > 0.
+
+    void SetTiming(std::uint32_t formulaId, int pool, std::uint64_t duration);
+    // Runs every step of formula 'formulaId' on 'pool' for 'duration'.
+    // Preconditions: 0 <= pool < GetPoolCount().
+
+    void SetDefaultTiming(int pool, std::uint64_t duration);
+    // Timing for formulas without their own.
+    // Preconditions: 0 <= pool < GetPoolCount().
+
+    int GetPoolCount() const { return static_cast<int>(machines.size()); }
+
+    ProductionReport Run(Stockpile &stockpile, std::uint64_t seed,
+                         bool record = false, std::uint64_t stepBase = 0) const;
+    // Simulates every step from time 0. When 'record' is set, steps are
+    // appended to the apply log as they complete, i.e. in time order.
+    // Preconditions: None.
+    // Postconditions: Stops early, with blockedStep set, when the next step
+    //                 lacks inputs and nothing running could supply them.
+    //                 Inputs taken by started steps are never returned.
+
+private:
+    struct Timing {
+        int pool;
+        std::uint64_t duration;
+    };
+
+    void CheckPool(int pool) const;
+
+    std::shared_ptr<const CompiledPlan> program;
+    std::vector<int> machines;                       // Per pool
+    std::unordered_map<std::uint32_t, Timing> timings; // By formula ID
+    Timing defaultTiming;
+};
+
+#endif // PRODUCTIONSIMULATOR_H
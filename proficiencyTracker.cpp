@@ -0,0 +1,45 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: proficiencyTracker.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the ProficiencyTracker class.
+
+#include "proficiencyTracker.h"
+
+// Experience only ever grows one point at a time, so a level can rise by at
+// most one per application and the thresholds must be strictly increasing
+static_assert([] {
+    for (int level = 1; level <= Formula::MaxProficiency; ++level) {
+        if (LevelExperience[level] <= LevelExperience[level - 1]) {
+            return false;
+        }
+    }
+    return LevelExperience[0] == 0;
+}(), "LevelExperience must start at 0 and increase strictly");
+
+std::uint32_t ProficiencyTracker::GetExperience(std::uint32_t formulaId) const {
+    return formulaId < progress.size() ? progress[formulaId].GetExperience() : 0;
+}
+
+std::size_t ProficiencyTracker::GetTrackedCount() const {
+    return static_cast<std::size_t>(std::count_if(
+            progress.begin(), progress.end(),
+            [](const Progress &entry) { return entry.GetExperience() > 0; }));
+}
+
+void ProficiencyTracker::Reset() {
+    progress.clear();
+}
+
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. Track, GetLevel and Accrue are inline because the executors call them
+//    for every step. Formula IDs come from a counter starting at 1, so the
+//    progress vector stays about as long as the number of formulas ever
+//    created, and a step costs one indexed access plus a comparison with
+//    the constexpr LevelExperience table. The rates for the level come
+//    from Formula's compile-time tier table, so progression adds no
+//    per-step floating-point work.
+// 2. Accrue raises the level by at most one, which the static_assert above
+//    makes sufficient.
@@ -0,0 +1,105 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: proficiencyTracker.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines ProficiencyTracker, which lets formulas improve with
+//              practice. Every successful application of a formula earns it
+//              one point of experience, and crossing a threshold of
+//              LevelExperience raises the level its next outcome tiers are
+//              drawn at, up to Formula::MaxProficiency. Progress is kept per
+//              formula identity, so every copy of a formula in a plan
+//              shares it.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. For every tracked formula, level is the largest L with
+//    LevelExperience[L] <= experience. GetLevel never returns less than the
+//    level the formula was compiled with.
+// 2. A formula enters the tracker on its first application, with the
+//    experience its compiled level requires; untracked formulas are at
+//    their compiled level. Every tracked formula has experience above 0.
+// 3. Progress only moves forward. Rolling back a Stockpile does not undo
+//    the experience of the steps rolled back.
+
+#ifndef PROFICIENCYTRACKER_H
+#define PROFICIENCYTRACKER_H
+
+#include "formula.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Cumulative experience a formula needs to reach each proficiency level.
+// Each level takes twice the practice of the previous one.
+constexpr std::uint32_t LevelExperience[Formula::MaxProficiency + 1] = {
+        0, 4, 12, 28, 60, 124, 252};
+
+class ProficiencyTracker {
+public:
+    // One formula's progress. Executors look it up once per step with Track
+    // and then read and credit it directly.
+    class Progress {
+    public:
+        int GetLevel(int compiledLevel) const {
+            return std::max(level, compiledLevel);
+        }
+        // Returns the level the next application draws its tier at.
+        // Preconditions: 0 <= compiledLevel <= Formula::MaxProficiency.
+
+        void Accrue(int compiledLevel) {
+            if (experience == 0) {
+                experience = LevelExperience[compiledLevel];
+                level = compiledLevel;
+            }
+            ++experience;
+            if (level < Formula::MaxProficiency &&
+                experience >= LevelExperience[level + 1]) {
+                ++level;
+            }
+        }
+        // Credits one application.
+        // Preconditions: Same as GetLevel.
+
+        std::uint32_t GetExperience() const { return experience; }
+
+    private:
+        std::uint32_t experience = 0; // 0 until the first application
+        int level = 0;
+    };
+
+    Progress &Track(std::uint32_t formulaId) {
+        if (formulaId >= progress.size()) {
+            progress.resize(formulaId + 1);
+        }
+        return progress[formulaId];
+    }
+    // Returns the progress of formula 'formulaId'.
+    // Preconditions: None.
+    // Postconditions: Allocates only when 'formulaId' is the highest ID seen
+    //                 so far; the reference is valid until the next Track of
+    //                 a higher ID or Reset.
+
+    int GetLevel(std::uint32_t formulaId, int compiledLevel) const {
+        return formulaId < progress.size() ? progress[formulaId].GetLevel(compiledLevel)
+                                           : compiledLevel;
+    }
+    // Returns the level the next application of formula 'formulaId' draws
+    // its tier at.
+    // Preconditions: 0 <= compiledLevel <= Formula::MaxProficiency.
+    // Postconditions: The tracker is not modified.
+
+    std::uint32_t GetExperience(std::uint32_t formulaId) const;
+    // Returns the experience formula 'formulaId' has accrued, or 0 if it
+    // was never applied while tracked.
+
+    std::size_t GetTrackedCount() const;
+    // Returns how many formulas have been applied while tracked.
+
+    void Reset();
+    // Forgets all progress.
+
+private:
+    std::vector<Progress> progress; // Indexed by formula ID, which is dense
+};
+
+#endif // PROFICIENCYTRACKER_H
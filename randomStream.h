@@ -0,0 +1,97 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: randomStream.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines RandomStream, a small explicitly seeded xoshiro256**
+//              generator. Executors own one stream and inject it into
+//              Formula::Apply, so formulas carry no generator state of their
+//              own and a run is reproducible from its seed.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. The 256-bit state is never all zero (guaranteed by SplitMix64 seeding).
+// 2. Two streams constructed with the same seed produce the same sequence,
+//    and copying a stream copies its position in the sequence.
+// 3. RandomStream satisfies UniformRandomBitGenerator, so it can drive the
+//    <random> distributions directly.
+
+#ifndef RANDOMSTREAM_H
+#define RANDOMSTREAM_H
+
+#include <cstdint>
+
+class RandomStream {
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr std::uint64_t DefaultSeed = 0x5eed5eed5eed5eedULL;
+
+    explicit RandomStream(std::uint64_t seed = DefaultSeed) { Seed(seed); }
+    // Creates a stream positioned at the start of the sequence for 'seed'.
+
+    RandomStream(std::uint64_t seed, std::uint64_t substream) {
+        std::uint64_t key = substream;
+        Seed(seed ^ SplitMix64(key));
+    }
+    // Creates substream number 'substream' of 'seed'. The stream depends only
+    // on the (seed, substream) pair, so work split across any number of
+    // threads sees the same random numbers.
+
+    void Seed(std::uint64_t seed) {
+        for (std::uint64_t &word : state) {
+            word = SplitMix64(seed);
+        }
+    }
+    // Restarts the stream at the beginning of the sequence for 'seed'.
+
+    std::uint64_t Next() {
+        const std::uint64_t result = RotateLeft(state[1] * 5, 7) * 9;
+        const std::uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = RotateLeft(state[3], 45);
+        return result;
+    }
+    // Returns the next 64 random bits.
+
+    int UniformInt(int low, int high) {
+        const std::uint64_t span = static_cast<std::uint32_t>(high - low) + 1ULL;
+        // Lemire's multiply-shift on 32 bits: unbiased after a rare rejection
+        std::uint64_t product = (Next() >> 32) * span;
+        std::uint32_t fraction = static_cast<std::uint32_t>(product);
+        if (fraction < span) {
+            const std::uint32_t threshold =
+                    static_cast<std::uint32_t>((0x100000000ULL - span) % span);
+            while (fraction < threshold) {
+                product = (Next() >> 32) * span;
+                fraction = static_cast<std::uint32_t>(product);
+            }
+        }
+        return low + static_cast<int>(product >> 32);
+    }
+    // Returns a uniformly distributed integer in [low, high].
+    // Preconditions: low <= high.
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+    result_type operator()() { return Next(); }
+
+private:
+    static std::uint64_t RotateLeft(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static std::uint64_t SplitMix64(std::uint64_t &x) {
+        std::uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    std::uint64_t state[4];
+};
+
+#endif // RANDOMSTREAM_H
@@ -0,0 +1,262 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: recipeReader.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the RecipeReader class.
+
+#include "recipeReader.h"
+#include "executablePlan.h"
+#include "formula.h"
+#include "plan.h"
+#include "stockpile.h"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define RECIPEREADER_HAS_FD 1
+#endif
+
+namespace {
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+void Trim(const char *&first, const char *&last) {
+    while (first < last && IsSpace(*first)) {
+        ++first;
+    }
+    while (last > first && IsSpace(last[-1])) {
+        --last;
+    }
+}
+
+} // namespace
+
+RecipeReader::RecipeReader(int fd, std::size_t bufferSize)
+        : fd(fd), in(nullptr), buffer(bufferSize), begin(0), end(0),
+          exhausted(false), lineNumber(0) {
+#ifndef RECIPEREADER_HAS_FD
+    throw std::runtime_error("Reading recipes from a descriptor is not supported");
+#endif
+    if (bufferSize == 0) {
+        throw std::invalid_argument("Recipe buffer size must be positive");
+    }
+}
+
+RecipeReader::RecipeReader(std::istream &in, std::size_t bufferSize)
+        : fd(-1), in(&in), buffer(bufferSize), begin(0), end(0),
+          exhausted(false), lineNumber(0) {
+    if (bufferSize == 0) {
+        throw std::invalid_argument("Recipe buffer size must be positive");
+    }
+}
+
+bool RecipeReader::Next(Formula &formula) {
+    const char *first;
+    const char *last;
+    while (NextLine(first, last)) {
+        const char *comment =
+                static_cast<const char *>(std::memchr(first, '#', last - first));
+        if (comment != nullptr) {
+            last = comment;
+        }
+        Trim(first, last);
+        if (first == last) {
+            continue;
+        }
+
+        const char *arrow = first;
+        while (arrow + 1 < last && !(arrow[0] == '-' && arrow[1] == '>')) {
+            ++arrow;
+        }
+        if (arrow + 1 >= last) {
+            Fail("expected '->' between inputs and outputs");
+        }
+        ParseSide(first, arrow, inputs);
+        ParseSide(arrow + 2, last, outputs);
+        if (inputs.empty() && outputs.empty()) {
+            Fail("recipe has no terms");
+        }
+
+        // Formula takes ownership of the arrays and interns the names
+        std::string *inputNames = new std::string[inputs.size()];
+        int *inputQuantities = new int[inputs.size()];
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            inputQuantities[i] = inputs[i].first;
+            inputNames[i] = std::move(inputs[i].second);
+        }
+        std::string *outputNames = new std::string[outputs.size()];
+        int *outputQuantities = new int[outputs.size()];
+        for (std::size_t i = 0; i < outputs.size(); ++i) {
+            outputQuantities[i] = outputs[i].first;
+            outputNames[i] = std::move(outputs[i].second);
+        }
+        formula = Formula(inputNames, inputQuantities,
+                          static_cast<int>(inputs.size()), outputNames,
+                          outputQuantities, static_cast<int>(outputs.size()));
+        return true;
+    }
+    return false;
+}
+
+int RecipeReader::AddTo(Plan &plan, int maxFormulas) {
+    int added = 0;
+    Formula formula;
+    while (added < maxFormulas && Next(formula)) {
+        plan.Add(std::move(formula));
+        ++added;
+    }
+    return added;
+}
+
+StreamResult RecipeReader::Stream(ExecutablePlan &plan, Stockpile &stockpile,
+                                  int batchSize, bool record) {
+    if (batchSize <= 0) {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+    StreamResult result{0, -1};
+    for (;;) {
+        plan.DiscardApplied();
+        if (plan.GetSize() < batchSize) {
+            AddTo(plan, batchSize - plan.GetSize());
+        }
+        if (plan.GetSize() == 0) {
+            return result;
+        }
+        RunResult run = plan.RunToCompletion(stockpile, record);
+        result.stepsApplied += static_cast<std::uint64_t>(run.stepsApplied);
+        if (run.failedStep >= 0) {
+            plan.DiscardApplied();
+            result.failedStep = static_cast<std::int64_t>(plan.GetFirstStep());
+            return result;
+        }
+    }
+}
+
+// NextLine: Hands out lines straight from the buffer, refilling it only
+// when no complete line is left.
+bool RecipeReader::NextLine(const char *&first, const char *&last) {
+    for (;;) {
+        const char *data = buffer.data();
+        const char *newline = static_cast<const char *>(
+                std::memchr(data + begin, '\n', end - begin));
+        if (newline != nullptr || (exhausted && begin < end)) {
+            first = data + begin;
+            last = (newline != nullptr) ? newline : data + end;
+            begin = (newline != nullptr) ? (newline - data) + 1 : end;
+            ++lineNumber;
+            return true;
+        }
+        if (exhausted) {
+            return false;
+        }
+        if (begin == 0 && end == buffer.size()) {
+            ++lineNumber;
+            Fail("line is longer than the " + std::to_string(buffer.size()) +
+                 "-byte buffer");
+        }
+        Fill();
+    }
+}
+
+bool RecipeReader::Fill() {
+    char *data = buffer.data();
+    if (begin > 0) {
+        std::memmove(data, data + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    std::size_t room = buffer.size() - end;
+    std::size_t got = 0;
+    if (in != nullptr) {
+        in->read(data + end, static_cast<std::streamsize>(room));
+        got = static_cast<std::size_t>(in->gcount());
+        if (in->bad()) {
+            Fail("read error");
+        }
+        exhausted = in->eof();
+    }
+#ifdef RECIPEREADER_HAS_FD
+    else {
+        ssize_t n;
+        do {
+            n = ::read(fd, data + end, room);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            Fail(std::string("read error: ") + std::strerror(errno));
+        }
+        got = static_cast<std::size_t>(n);
+        exhausted = (n == 0);
+    }
+#endif
+    end += got;
+    return !exhausted || got > 0;
+}
+
+// ParseSide: Parses "2 Water + 1 Carbon" into (quantity, name) pairs.
+void RecipeReader::ParseSide(const char *first, const char *last,
+                             std::vector<std::pair<int, std::string>> &terms) const {
+    terms.clear();
+    Trim(first, last);
+    if (first == last) {
+        return;
+    }
+    for (;;) {
+        const char *plus = first;
+        while (plus < last && *plus != '+') {
+            ++plus;
+        }
+        const char *termFirst = first;
+        const char *termLast = plus;
+        Trim(termFirst, termLast);
+        if (termFirst == termLast) {
+            Fail("empty term");
+        }
+
+        long long quantity = 0;
+        const char *cursor = termFirst;
+        if (*cursor < '0' || *cursor > '9') {
+            Fail("expected a quantity at '" + std::string(termFirst, termLast) + "'");
+        }
+        while (cursor < termLast && *cursor >= '0' && *cursor <= '9') {
+            quantity = quantity * 10 + (*cursor - '0');
+            if (quantity > INT_MAX) {
+                Fail("quantity is too large");
+            }
+            ++cursor;
+        }
+        if (cursor == termLast || !IsSpace(*cursor)) {
+            Fail("expected a resource name after the quantity in '" +
+                 std::string(termFirst, termLast) + "'");
+        }
+        Trim(cursor, termLast);
+        terms.emplace_back(static_cast<int>(quantity),
+                           std::string(cursor, termLast));
+
+        if (plus == last) {
+            return;
+        }
+        first = plus + 1;
+    }
+}
+
+void RecipeReader::Fail(const std::string &message) const {
+    throw std::runtime_error("Recipe line " + std::to_string(lineNumber) +
+                             ": " + message);
+}
+
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. begin <= end <= buffer.size(), and buffer[begin, end) holds exactly the
+//    input not yet handed out by NextLine.
+// 2. Fill only runs when no complete line is buffered, and moves the partial
+//    line to the front first, so a line up to the buffer size always fits.
+// 3. The term vectors are cleared and reused for every line, and only the
+//    Formula built from a line owns per-line allocations.
+// 4. Stream calls DiscardApplied before every batch, so the plan holds at
+//    most 'batchSize' formulas plus any the caller left pending.
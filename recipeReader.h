@@ -0,0 +1,120 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: recipeReader.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines RecipeReader, a streaming parser for the text recipe
+//              format, one formula per line:
+//
+//                  # Comments run to the end of the line
+//                  2 Water + 1 Carbon -> 1 Glucose
+//                  1 Glucose + 1 Sunlight -> 2 Oxygen + 1 Energy
+//
+//              Every term is a non-negative quantity followed by a resource
+//              name, which may contain inner spaces. Either side of "->" may
+//              be empty, but not both. The reader pulls input through a
+//              fixed-size buffer, so it can feed an executing plan from a
+//              pipe or a file of any size.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. The reader never holds more than its buffer of unparsed text plus the
+//    formula being built; a line longer than the buffer is an error, not a
+//    reason to grow.
+// 2. Names are interned by the Formula constructor as each line is parsed,
+//    so the only state that grows with the input is the resource registry,
+//    i.e. the vocabulary.
+// 3. Errors name the 1-based line they occurred on.
+
+#ifndef RECIPEREADER_H
+#define RECIPEREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ExecutablePlan;
+class Formula;
+class Plan;
+class Stockpile;
+
+// Outcome of streaming a recipe into an executing plan.
+struct StreamResult {
+    std::uint64_t stepsApplied; // Steps applied during the call
+    std::int64_t failedStep;    // Number of the step that failed, or -1
+};
+
+class RecipeReader {
+public:
+    static constexpr std::size_t DefaultBufferSize = 1 << 16;
+
+    explicit RecipeReader(int fd, std::size_t bufferSize = DefaultBufferSize);
+    // Reads from a file descriptor, e.g. 0 for stdin. The descriptor stays
+    // owned by the caller.
+    // Preconditions: 'fd' is open for reading; bufferSize > 0.
+
+    explicit RecipeReader(std::istream &in,
+                          std::size_t bufferSize = DefaultBufferSize);
+    // Reads from a stream, which must outlive the reader.
+    // Preconditions: bufferSize > 0.
+
+    RecipeReader(const RecipeReader &) = delete;
+    RecipeReader &operator=(const RecipeReader &) = delete;
+
+    bool Next(Formula &formula);
+    // Parses the next recipe line into 'formula', skipping blank lines and
+    // comments.
+    // Preconditions: None.
+    // Postconditions: Returns false at the end of the input. Throws
+    //                 std::runtime_error for a malformed line, a line longer
+    //                 than the buffer or a read error.
+
+    int AddTo(Plan &plan, int maxFormulas);
+    // Appends up to 'maxFormulas' parsed formulas to 'plan'.
+    // Preconditions: maxFormulas >= 0.
+    // Postconditions: Returns the number appended; fewer than requested
+    //                 only at the end of the input.
+
+    StreamResult Stream(ExecutablePlan &plan, Stockpile &stockpile,
+                        int batchSize = 1024, bool record = false);
+    // Alternates between appending up to 'batchSize' formulas to 'plan' and
+    // running them, dropping each batch once applied. The plan never holds
+    // more than one batch, and with 'record' off the stockpile's apply log
+    // does not grow, so memory does not depend on the input size. Steps
+    // keep their numbers and substreams, so the run matches a run of the
+    // whole recipe loaded up front with the same seed.
+    // Preconditions: batchSize > 0.
+    // Postconditions: Stops at the end of the input or at the first step
+    //                 with insufficient resources. That step, and any
+    //                 formulas read after it, stay in 'plan' unapplied.
+
+    std::size_t GetLineNumber() const { return lineNumber; }
+    // Returns the number of lines consumed so far.
+
+private:
+    bool NextLine(const char *&first, const char *&last);
+    // Sets [first, last) to the next line without its terminator; the range
+    // stays valid until the next call. Returns false at end of input.
+
+    bool Fill();
+    // Moves unconsumed text to the front of the buffer and reads more.
+    // Returns false once the input is exhausted.
+
+    void ParseSide(const char *first, const char *last,
+                   std::vector<std::pair<int, std::string>> &terms) const;
+    [[noreturn]] void Fail(const std::string &message) const;
+
+    int fd;            // Source descriptor, or -1 when reading 'in'
+    std::istream *in;  // Source stream, or null when reading 'fd'
+    std::vector<char> buffer;
+    std::size_t begin; // First unconsumed byte in 'buffer'
+    std::size_t end;   // One past the last byte read into 'buffer'
+    bool exhausted;    // The source returned end of input
+    std::size_t lineNumber;
+    std::vector<std::pair<int, std::string>> inputs;  // Reused per line
+    std::vector<std::pair<int, std::string>> outputs; // Reused per line
+};
+
+#endif // RECIPEREADER_H
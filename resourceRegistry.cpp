@@ -0,0 +1,43 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: resourceRegistry.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the ResourceRegistry class.
+
+#include "resourceRegistry.h"
+#include <stdexcept>
+
+ResourceRegistry &ResourceRegistry::Global() {
+    static ResourceRegistry registry;
+    return registry;
+}
+
+ResourceId ResourceRegistry::Intern(std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ids.find(name);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    ResourceId id = static_cast<ResourceId>(names.size());
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+ResourceId ResourceRegistry::Find(std::string_view name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ids.find(name);
+    return it != ids.end() ? it->second : InvalidResource;
+}
+
+const std::string &ResourceRegistry::Name(ResourceId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (id >= names.size()) {
+        throw std::out_of_range("Unknown resource id");
+    }
+    return names[id];
+}
+
+std::size_t ResourceRegistry::Size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.size();
+}
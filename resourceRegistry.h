@@ -0,0 +1,67 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: resourceRegistry.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines the ResourceRegistry, which interns resource names into
+//              small dense integer IDs. Formulas resolve their resource names
+//              once at construction so that the Stockpile and the execution
+//              hot path can work on array indices instead of strings.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. IDs are handed out densely starting at 0, in order of first interning.
+// 2. A name maps to exactly one ID for the lifetime of the registry, and the
+//    ID never changes or gets reused.
+// 3. Name(id) returns a reference that stays valid for the lifetime of the
+//    registry, even while other names are being interned.
+// 4. The map is keyed by views into 'names', so looking a name up never
+//    copies it.
+
+#ifndef RESOURCEREGISTRY_H
+#define RESOURCEREGISTRY_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using ResourceId = std::uint32_t;
+
+// Sentinel returned by lookups for names that were never interned.
+constexpr ResourceId InvalidResource = UINT32_MAX;
+
+class ResourceRegistry {
+public:
+    static ResourceRegistry &Global();
+    // Returns the process-wide registry used by Formula and Stockpile.
+    // Preconditions: None.
+    // Postconditions: The same instance is returned on every call.
+
+    ResourceId Intern(std::string_view name);
+    // Returns the ID for 'name', assigning the next free ID if it is new.
+    // Preconditions: None.
+    // Postconditions: Find(name) returns the same ID from now on.
+
+    ResourceId Find(std::string_view name) const;
+    // Returns the ID for 'name' without interning it.
+    // Preconditions: None.
+    // Postconditions: Returns InvalidResource if 'name' was never interned.
+    //                 Does not allocate.
+
+    const std::string &Name(ResourceId id) const;
+    // Returns the name that was interned as 'id'.
+    // Preconditions: id < Size().
+    // Postconditions: Throws out_of_range for unknown IDs.
+
+    std::size_t Size() const;
+    // Returns the number of interned names, i.e. one past the largest ID.
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<std::string_view, ResourceId> ids; // Views into 'names'
+    std::deque<std::string> names; // Deque keeps Name() references stable
+};
+
+#endif // RESOURCEREGISTRY_H
@@ -0,0 +1,168 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: shardedStockpile.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Implements the ShardedStockpile and StockpileShard classes.
+
+#include "shardedStockpile.h"
+#include "formula.h"
+#include "proficiencyTracker.h"
+#include "randomStream.h"
+#include "stockpile.h"
+#include <algorithm>
+#include <stdexcept>
+
+StockpileShard::StockpileShard(ShardedStockpile &owner, std::size_t bound)
+        : owner(owner), balance(bound, 0), isTouched(bound, false) {}
+
+void StockpileShard::AddResource(ResourceId id, std::int64_t quantity) {
+    if (id >= balance.size()) {
+        throw std::out_of_range("Resource outside the sharded stockpile");
+    }
+    Touch(id);
+    balance[id] += quantity;
+}
+
+bool StockpileShard::ConsumeResource(ResourceId id, std::int64_t quantity) {
+    if (id >= balance.size()) {
+        return quantity == 0;
+    }
+    if (balance[id] < quantity && !Reserve(id, quantity)) {
+        return false;
+    }
+    balance[id] -= quantity;
+    return true;
+}
+
+// Transact: The same debit-then-roll-back pass as Stockpile::Transact; a
+// rolled-back debit returns to this shard's balance, not to the master.
+bool StockpileShard::Transact(const CompiledFormula &formula,
+                              MultiplierTier tier) {
+    for (int i = 0; i < formula.outputCount; ++i) {
+        if (formula.outputs[i].id >= balance.size()) {
+            throw std::out_of_range("Output outside the sharded stockpile");
+        }
+    }
+    for (int i = 0; i < formula.inputCount; ++i) {
+        if (ConsumeResource(formula.inputs[i].id, formula.inputs[i].quantity)) {
+            continue;
+        }
+        while (i-- > 0) {
+            if (formula.inputs[i].id < balance.size()) {
+                balance[formula.inputs[i].id] += formula.inputs[i].quantity;
+            }
+        }
+        return false;
+    }
+    for (int i = 0; i < formula.outputCount; ++i) {
+        const ResourceAmount &output = formula.outputs[i];
+        Touch(output.id);
+        balance[output.id] += AdjustQuantity(output.quantity, tier);
+    }
+    return true;
+}
+
+RunResult StockpileShard::Execute(const CompiledPlan &program, int begin,
+                                  int end, std::uint64_t seed,
+                                  std::uint64_t stepBase,
+                                  ProficiencyTracker *proficiency) {
+    if (program.GetResourceBound() > balance.size()) {
+        throw std::out_of_range("Plan uses resources outside the sharded stockpile");
+    }
+    for (int i = begin; i < end; ++i) {
+        CompiledFormula step = program.GetStep(i);
+        RandomStream rng(seed, stepBase + static_cast<std::uint64_t>(i));
+        ProficiencyTracker::Progress *practice =
+                (proficiency != nullptr) ? &proficiency->Track(step.formulaId) : nullptr;
+        const int level = (practice != nullptr) ? practice->GetLevel(step.proficiencyLevel)
+                                                : step.proficiencyLevel;
+        if (!Transact(step, Formula::DetermineMultiplier(level, rng))) {
+            return RunResult{i - begin, i};
+        }
+        if (practice != nullptr) {
+            practice->Accrue(step.proficiencyLevel);
+        }
+    }
+    return RunResult{end - begin, -1};
+}
+
+std::int64_t StockpileShard::GetBalance(ResourceId id) const {
+    return id < balance.size() ? balance[id] : 0;
+}
+
+void StockpileShard::Flush() {
+    std::lock_guard<std::mutex> lock(owner.mutex);
+    ReturnBalances(owner.master);
+}
+
+// Reserve: Takes the shortfall plus a batch, or whatever the master has
+// left, so a shard that keeps consuming goes to the master once per batch.
+bool StockpileShard::Reserve(ResourceId id, std::int64_t quantity) {
+    Touch(id);
+    const std::int64_t shortfall = quantity - balance[id];
+    std::lock_guard<std::mutex> lock(owner.mutex);
+    const std::int64_t available = owner.master.GetQuantity(id);
+    const std::int64_t taken = std::min(available, shortfall + owner.reservationBatch);
+    if (taken < shortfall) {
+        return false; // Leave the master as it is; nothing would come of it
+    }
+    owner.master.ConsumeResource(id, taken);
+    balance[id] += taken;
+    return true;
+}
+
+void StockpileShard::Touch(ResourceId id) {
+    if (!isTouched[id]) {
+        isTouched[id] = true;
+        touched.push_back(id);
+    }
+}
+
+void StockpileShard::ReturnBalances(Stockpile &master) {
+    for (ResourceId id : touched) {
+        if (balance[id] != 0) {
+            master.AddResource(id, balance[id]);
+            balance[id] = 0;
+        }
+        isTouched[id] = false;
+    }
+    touched.clear();
+}
+
+ShardedStockpile::ShardedStockpile(Stockpile &master, std::size_t bound,
+                                   std::int64_t reservationBatch)
+        : master(master), bound(bound), reservationBatch(reservationBatch) {
+    if (reservationBatch < 0) {
+        throw std::invalid_argument("Reservation batch must not be negative");
+    }
+    master.Reserve(bound);
+}
+
+StockpileShard &ShardedStockpile::CreateShard() {
+    std::unique_ptr<StockpileShard> shard(new StockpileShard(*this, bound));
+    std::lock_guard<std::mutex> lock(mutex);
+    shards.push_back(std::move(shard));
+    return *shards.back();
+}
+
+void ShardedStockpile::EndEpoch() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::unique_ptr<StockpileShard> &shard : shards) {
+        shard->ReturnBalances(master);
+    }
+}
+
+
+// =============================================================================
+// ------------------------ IMPLEMENTATION INVARIANTS ---------------------------
+// =============================================================================
+// 1. Stock moves between the master and a shard only in Reserve (master to
+//    shard, never more than the master holds) and ReturnBalances (shard to
+//    master, the whole balance), both under 'mutex'; everything else a
+//    shard does touches only its own vectors.
+// 2. A balance only goes down through ConsumeResource after checking that
+//    it covers the quantity, so it never goes negative.
+// 3. 'touched' lists exactly the IDs whose isTouched flag is set, and every
+//    non-zero balance is among them, so a flush costs time proportional to
+//    the resources the shard used, not to the resource bound.
+// 4. Reserve leaves the master untouched when it cannot cover the
+//    shortfall, so a failing consume never moves stock into a shard.
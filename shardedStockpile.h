@@ -0,0 +1,133 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: shardedStockpile.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines ShardedStockpile and StockpileShard, which let many
+//              workers share one master Stockpile without touching shared
+//              memory on every operation. Each worker owns a shard: a
+//              private balance per resource over the dense ID space. What a
+//              worker produces goes straight into its balance; what it
+//              consumes comes out of it. When a balance runs short, the
+//              shard reserves more from the master under a lock, taking
+//              the stock out of the master so that no other shard can
+//              spend it. Balances flow back to the master when a shard is
+//              flushed, and all of them at every epoch boundary.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. Every unit of stock is either in the master or in exactly one shard's
+//    balance, so master total plus all balances is the true inventory, and
+//    no balance or master quantity is ever negative: a consume can never
+//    over-draw the global stock.
+// 2. After EndEpoch, every balance is zero and the master holds exactly
+//    what a serial Stockpile applying the same successful operations would.
+// 3. Reservation is conservative: a shard may hold stock another shard is
+//    short of until its next flush, so a consume can fail although the
+//    inventory as a whole had enough. Such failures are reported, never
+//    retried silently.
+// 4. Only the worker that owns a shard calls its methods; the master is
+//    touched only under the ShardedStockpile's mutex.
+
+#ifndef SHARDEDSTOCKPILE_H
+#define SHARDEDSTOCKPILE_H
+
+#include "applyLog.h"
+#include "compiledPlan.h"
+#include "resourceRegistry.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ProficiencyTracker;
+class ShardedStockpile;
+class Stockpile;
+
+class StockpileShard {
+public:
+    StockpileShard(const StockpileShard &) = delete;
+    StockpileShard &operator=(const StockpileShard &) = delete;
+
+    void AddResource(ResourceId id, std::int64_t quantity);
+    // Adds 'quantity' to this shard's balance; no other thread is involved.
+    // Preconditions: quantity >= 0.
+    // Postconditions: Throws std::out_of_range past the resource bound.
+
+    bool ConsumeResource(ResourceId id, std::int64_t quantity);
+    // Removes 'quantity' from the balance, first reserving the shortfall
+    // plus a batch from the master if the balance is short.
+    // Preconditions: quantity >= 0.
+    // Postconditions: Returns false, with the balance kept, if the balance
+    //                 and the master together did not have enough.
+
+    bool Transact(const CompiledFormula &formula, MultiplierTier tier);
+    // Stockpile::Transact against this shard, reserving as ConsumeResource
+    // does.
+    // Postconditions: Throws std::out_of_range, changing nothing, if an
+    //                 output ID is past the resource bound.
+
+    RunResult Execute(const CompiledPlan &program, int begin, int end,
+                      std::uint64_t seed, std::uint64_t stepBase = 0,
+                      ProficiencyTracker *proficiency = nullptr);
+    // ConcurrentStockpile::Execute's contract, against this shard.
+
+    std::int64_t GetBalance(ResourceId id) const;
+    // Returns what this shard holds of 'id' right now.
+
+    void Flush();
+    // Returns every balance to the master, under its lock.
+    // Postconditions: Every balance is zero.
+
+private:
+    friend class ShardedStockpile;
+    StockpileShard(ShardedStockpile &owner, std::size_t bound);
+
+    bool Reserve(ResourceId id, std::int64_t quantity);
+    // Makes the balance of 'id' at least 'quantity' from the master.
+    void Touch(ResourceId id);
+    // Remembers 'id' so Flush visits only the resources this shard used.
+    void ReturnBalances(Stockpile &master);
+    // Moves every balance into 'master'; the caller holds its lock.
+
+    ShardedStockpile &owner;
+    std::vector<std::int64_t> balance; // Indexed by ResourceId
+    std::vector<ResourceId> touched;   // IDs with a possibly non-zero balance
+    std::vector<bool> isTouched;       // Membership flags for 'touched'
+};
+
+class ShardedStockpile {
+public:
+    ShardedStockpile(Stockpile &master, std::size_t bound,
+                     std::int64_t reservationBatch = 256);
+    // Shares 'master', which must outlive this object and must not be used
+    // directly until EndEpoch, among shards covering the IDs below 'bound'.
+    // Each reservation takes up to 'reservationBatch' units beyond the
+    // shortfall, so a consuming worker visits the master about once per
+    // batch.
+    // Preconditions: reservationBatch >= 0.
+
+    StockpileShard &CreateShard();
+    // Creates a shard for one worker. The shard lives as long as this
+    // object.
+    // Preconditions: No epoch is being ended concurrently.
+
+    void EndEpoch();
+    // Flushes every shard, bringing the master up to date.
+    // Preconditions: No worker is using a shard.
+    // Postconditions: Every balance is zero; the master is exact.
+
+    std::size_t GetResourceBound() const { return bound; }
+    std::size_t GetShardCount() const { return shards.size(); }
+
+private:
+    friend class StockpileShard;
+
+    Stockpile &master;
+    std::size_t bound;
+    std::int64_t reservationBatch;
+    std::mutex mutex; // Guards 'master' and 'shards'
+    std::vector<std::unique_ptr<StockpileShard>> shards;
+};
+
+#endif // SHARDEDSTOCKPILE_H
@@ -1,9 +1,56 @@
+#include "concurrentStockpile.h"
+#include "ensembleRunner.h"
 #include "executablePlan.h"
+#include "expectedYield.h"
+#include "feasibilityTable.h"
 #include "formula.h"
+#include "planAnalyzer.h"
+#include "planArchive.h"
+#include "planScheduler.h"
+#include "planSynthesizer.h"
+#include "productionSimulator.h"
+#include "recipeReader.h"
+#include "shardedStockpile.h"
+#include "staticFormula.h"
 #include "stockpile.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <new>
+#include <sstream>
 #include <string>
+#include <thread>
+
+// Counts every allocation made through operator new, so tests can check
+// that a code path does not allocate
+static std::atomic<std::size_t> AllocationCount{0};
+
+// Kept out of line so that GCC does not pair an inlined malloc with an
+// inlined free and warn about mismatched new and delete
+#if defined(__GNUC__) || defined(__clang__)
+#define ALLOCATOR_NOINLINE __attribute__((noinline))
+#else
+#define ALLOCATOR_NOINLINE
+#endif
+
+ALLOCATOR_NOINLINE void *operator new(std::size_t size) {
+    AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *block = std::malloc(size != 0 ? size : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+ALLOCATOR_NOINLINE void operator delete(void *block) noexcept {
+    std::free(block);
+}
+
+ALLOCATOR_NOINLINE void operator delete(void *block, std::size_t) noexcept {
+    std::free(block);
+}
 
 // Function to create a Formula object using maps for input and output resources
 Formula createFormula(
@@ -66,8 +113,9 @@ void Test_Formula_Apply() {
     // Create formula
     Formula formula = createFormula(inputResources, outputResources);
 
-    // Simulate formula application
-    std::string result = formula.Apply();
+    // Simulate formula application with an explicitly seeded stream
+    RandomStream rng(42);
+    std::string result = formula.Describe(formula.Apply(rng));
     std::cout << "Formula Application Result: " << result << std::endl;
 }
 
@@ -84,6 +132,15 @@ void Test_Stockpile_AddResource() {
     // Display added resources
     std::cout << "Water Quantity: " << stockpile.GetQuantity("Water") << std::endl;
     std::cout << "Carbon Quantity: " << stockpile.GetQuantity("Carbon") << std::endl;
+
+    // An unchecked Find() of an unknown name must not size the storage
+    try {
+        stockpile.AddResource(ResourceRegistry::Global().Find("Unobtainium"), 1);
+        std::cout << "Unknown resource accepted" << std::endl;
+    } catch (const std::out_of_range&) {
+        std::cout << "Unknown resource rejected, bound: "
+                  << stockpile.GetResourceBound() << std::endl;
+    }
 }
 
 void Test_ExecutablePlan_ApplyCurrentFormula() {
@@ -112,6 +169,8 @@ void Test_ExecutablePlan_ApplyCurrentFormula() {
         for (const auto& result : updatedStockpile->GetApplyResults()) {
             std::cout << "Apply Result: " << result << std::endl;
         }
+        std::cout << "Glucose Quantity: "
+                  << updatedStockpile->GetQuantity("Glucose") << std::endl;
     } catch (const std::exception& e) {
         std::cout << "Exception caught: " << e.what() << std::endl;
     }
@@ -190,12 +249,835 @@ void Test_ExecutablePlan_ReplaceFormula() {
     delete[] newFormulasArray;
 }
 
+void Test_ExecutablePlan_RunToCompletion() {
+    std::cout << "\nTesting Running an Executable Plan to Completion:\n";
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 1}}},
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 1}}},
+            {{{"Glucose", 1}, {"Sunlight", 1}}, {{"Oxygen", 2}, {"Energy", 1}}}
+    };
+    Formula* formulasArray = createFormulasArray(resources);
+    ExecutablePlan plan(formulasArray, resources.size());
+    delete[] formulasArray;
+    plan.Seed(5);
+
+    Stockpile stockpile;
+    stockpile.AddResource("Water", 4);
+    stockpile.AddResource("Carbon", 2);
+    stockpile.AddResource("Sunlight", 1);
+
+    RunResult result = plan.RunToCompletion(stockpile);
+    std::cout << "Steps applied: " << result.stepsApplied
+              << ", failed step: " << result.failedStep << std::endl;
+    std::cout << "Oxygen Quantity: " << stockpile.GetQuantity("Oxygen")
+              << ", Energy Quantity: " << stockpile.GetQuantity("Energy")
+              << std::endl;
+}
+
+void Test_EnsembleRunner_Run() {
+    std::cout << "\nTesting Ensemble Runs of a Stochastic Plan:\n";
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 10}}},
+            {{{"Glucose", 5}, {"Sunlight", 1}}, {{"Oxygen", 20}, {"Energy", 10}}}
+    };
+    Formula* formulasArray = createFormulasArray(resources);
+    Plan plan(formulasArray, resources.size());
+    delete[] formulasArray;
+
+    Stockpile initial;
+    initial.AddResource("Water", 2);
+    initial.AddResource("Carbon", 1);
+    initial.AddResource("Sunlight", 1);
+
+    EnsembleOptions options;
+    options.replicas = 10000;
+    options.seed = 2024;
+    EnsembleResult result = EnsembleRunner(plan, options).Run(initial);
+
+    const ResourceStatistics& oxygen =
+            result.resources[ResourceRegistry::Global().Find("Oxygen")];
+    std::cout << "Completed replicas: " << result.completedReplicas << "/"
+              << result.replicas << std::endl;
+    std::cout << "Oxygen mean: " << oxygen.mean << ", p05: " << oxygen.p05
+              << ", p50: " << oxygen.p50 << ", p95: " << oxygen.p95 << std::endl;
+}
+
+void Test_PlanScheduler_MatchesSequential() {
+    std::cout << "\nTesting Parallel Scheduling of Independent Formulas:\n";
+
+    // Two chains that share no resources, interleaved step by step
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 1}}},
+            {{{"Ore", 3}}, {{"Iron", 2}}},
+            {{{"Glucose", 1}, {"Sunlight", 1}}, {{"Oxygen", 2}, {"Energy", 1}}},
+            {{{"Iron", 1}, {"Coal", 1}}, {{"Steel", 1}}}
+    };
+    Formula* formulasArray = createFormulasArray(resources);
+    ExecutablePlan plan(formulasArray, resources.size());
+    delete[] formulasArray;
+    plan.Seed(11);
+
+    Stockpile sequential;
+    Stockpile parallel;
+    for (Stockpile* stockpile : {&sequential, &parallel}) {
+        stockpile->AddResource("Water", 2);
+        stockpile->AddResource("Carbon", 1);
+        stockpile->AddResource("Sunlight", 1);
+        stockpile->AddResource("Ore", 3);
+        stockpile->AddResource("Coal", 1);
+    }
+
+    PlanScheduler scheduler(plan);
+    RunResult expected = plan.RunToCompletion(sequential);
+    RunResult actual = scheduler.Run(parallel, 11, 4);
+
+    bool identical = expected.failedStep == actual.failedStep;
+    for (const char* name : {"Water", "Glucose", "Oxygen", "Energy", "Iron", "Steel"}) {
+        identical = identical && sequential.GetQuantity(name) == parallel.GetQuantity(name);
+    }
+    std::cout << "Dependency edges: " << scheduler.GetGraph().GetEdgeCount()
+              << ", matches sequential run: " << (identical ? "yes" : "no")
+              << std::endl;
+}
+
+void Test_ExpectedYield_MatchesEnsemble() {
+    std::cout << "\nTesting Closed-Form Expected Yield Against the Ensemble:\n";
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources(
+            50, {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 10}}});
+    Formula* formulasArray = createFormulasArray(resources);
+    Plan plan(formulasArray, resources.size());
+    delete[] formulasArray;
+
+    Stockpile initial;
+    initial.AddResource("Water", 100);
+    initial.AddResource("Carbon", 50);
+
+    ResourceId glucose = ResourceRegistry::Global().Find("Glucose");
+    ResourceMoments expected =
+            ExpectedYieldEvaluator(plan).Evaluate(initial)[glucose];
+
+    EnsembleOptions options;
+    options.replicas = 20000;
+    EnsembleResult sampled = EnsembleRunner(plan, options).Run(initial);
+
+    std::cout << "Glucose analytic mean: " << expected.mean
+              << ", variance: " << expected.variance << std::endl;
+    std::cout << "Glucose ensemble mean: " << sampled.resources[glucose].mean
+              << ", variance: " << sampled.resources[glucose].variance
+              << std::endl;
+}
+
+void Test_Plan_CopyOnWriteFork() {
+    std::cout << "\nTesting Forking a Plan and Replacing One Formula:\n";
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources;
+    for (int i = 0; i < 200; ++i) {
+        resources.push_back({{{"A", 1}}, {{"B", 1}}});
+    }
+    Formula* formulasArray = createFormulasArray(resources);
+    Plan original(formulasArray, static_cast<int>(resources.size()));
+
+    // The fork shares storage until it is modified
+    Plan fork(original);
+    std::cout << "Fork equals original: " << (fork == original ? "yes" : "no") << std::endl;
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> replacement = {
+            {{{"C", 3}}, {{"D", 4}}}
+    };
+    Formula* replacementArray = createFormulasArray(replacement);
+    fork.Replace(130, std::move(replacementArray[0]));
+
+    std::cout << "Original step 131 input: " << original.GetFormula(130).GetInputName(0)
+              << ", fork step 131 input: " << fork.GetFormula(130).GetInputName(0)
+              << ", plans equal: " << (fork == original ? "yes" : "no") << std::endl;
+
+    delete[] formulasArray;
+    delete[] replacementArray;
+}
+
+void Test_Stockpile_CheckpointRollback() {
+    std::cout << "\nTesting Rolling a Stockpile Back to a Checkpoint:\n";
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 1}}},
+            {{{"Glucose", 1}, {"Sunlight", 1}}, {{"Oxygen", 2}, {"Energy", 1}}}
+    };
+    Formula* formulasArray = createFormulasArray(resources);
+    ExecutablePlan plan(formulasArray, resources.size());
+    delete[] formulasArray;
+
+    Stockpile stockpile;
+    stockpile.AddResource("Water", 2);
+    stockpile.AddResource("Carbon", 1);
+    stockpile.AddResource("Sunlight", 1);
+
+    StockpileCheckpoint checkpoint = stockpile.Checkpoint();
+    ExecutablePlan branch(plan);
+    RunResult result = branch.RunToCompletion(stockpile);
+    std::cout << "Branch applied " << result.stepsApplied << " steps, Water: "
+              << stockpile.GetQuantity("Water") << ", journal entries: "
+              << stockpile.GetJournalSize() << std::endl;
+
+    stockpile.RollbackTo(checkpoint);
+    stockpile.DiscardCheckpoints();
+    std::cout << "After rollback Water: " << stockpile.GetQuantity("Water")
+              << ", Carbon: " << stockpile.GetQuantity("Carbon")
+              << ", Glucose: " << stockpile.GetQuantity("Glucose")
+              << ", log records: " << stockpile.GetApplyLog().GetSize() << std::endl;
+
+    // A checkpoint from before DiscardCheckpoints must not be accepted,
+    // even once the journal has grown past its position again
+    StockpileCheckpoint discarded = stockpile.Checkpoint();
+    stockpile.AddResource("Water", 1);
+    stockpile.DiscardCheckpoints();
+    stockpile.Checkpoint();
+    stockpile.AddResource("Water", 10);
+    try {
+        stockpile.RollbackTo(discarded);
+        std::cout << "Discarded checkpoint accepted, Water: "
+                  << stockpile.GetQuantity("Water") << std::endl;
+    } catch (const std::invalid_argument&) {
+        std::cout << "Discarded checkpoint rejected, Water: "
+                  << stockpile.GetQuantity("Water") << std::endl;
+    }
+    stockpile.DiscardCheckpoints();
+
+    // Nor a checkpoint taken after one that was rolled back to
+    StockpileCheckpoint earlier = stockpile.Checkpoint();
+    stockpile.AddResource("Water", 1);
+    StockpileCheckpoint later = stockpile.Checkpoint();
+    stockpile.AddResource("Water", 1);
+    stockpile.RollbackTo(earlier);
+    stockpile.AddResource("Carbon", 1);
+    stockpile.AddResource("Carbon", 1);
+    try {
+        stockpile.RollbackTo(later);
+        std::cout << "Overtaken checkpoint accepted, Water: "
+                  << stockpile.GetQuantity("Water") << std::endl;
+    } catch (const std::invalid_argument&) {
+        std::cout << "Overtaken checkpoint rejected, Water: "
+                  << stockpile.GetQuantity("Water") << std::endl;
+    }
+    stockpile.RollbackTo(earlier);
+    stockpile.DiscardCheckpoints();
+    std::cout << "After both rollbacks Water: " << stockpile.GetQuantity("Water")
+              << ", Carbon: " << stockpile.GetQuantity("Carbon") << std::endl;
+}
+
+void Test_PlanArchive_RoundTrip() {
+    std::cout << "\nTesting Saving and Mapping a Plan Archive:\n";
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 1}}},
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 1}}},
+            {{{"Glucose", 1}, {"Sunlight", 1}}, {{"Oxygen", 2}, {"Energy", 1}}}
+    };
+    Formula* formulasArray = createFormulasArray(resources);
+    ExecutablePlan plan(formulasArray, resources.size());
+    delete[] formulasArray;
+    plan.Seed(5);
+
+    Stockpile initial;
+    initial.AddResource("Water", 4);
+    initial.AddResource("Carbon", 2);
+    initial.AddResource("Sunlight", 1);
+
+    const std::string planPath = "simulator_test_plan.bin";
+    const std::string stockpilePath = "simulator_test_stockpile.bin";
+    SavePlan(plan, planPath);
+    SaveStockpile(initial, stockpilePath);
+
+    std::shared_ptr<const CompiledPlan> loaded = LoadPlan(planPath);
+    Stockpile fromArchive;
+    LoadStockpile(stockpilePath, fromArchive);
+    fromArchive.Reserve(loaded->GetResourceBound());
+    RunResult loadedResult = loaded->Execute(0, loaded->GetSize(), fromArchive, 5, false);
+
+    RunResult result = plan.RunToCompletion(initial);
+    std::cout << "Loaded steps: " << loaded->GetSize()
+              << ", applied: " << loadedResult.stepsApplied << "/" << result.stepsApplied
+              << ", Oxygen: " << fromArchive.GetQuantity("Oxygen") << "/"
+              << initial.GetQuantity("Oxygen") << std::endl;
+
+    std::remove(planPath.c_str());
+    std::remove(stockpilePath.c_str());
+}
+
+void Test_RecipeReader_Stream() {
+    std::cout << "\nTesting Streaming a Text Recipe into an Executable Plan:\n";
+
+    std::istringstream recipe(
+            "# Photosynthesis\n"
+            "2 Water + 1 Carbon -> 1 Glucose\n"
+            "\n"
+            "2 Water + 1 Carbon -> 1 Glucose\n"
+            "1 Glucose + 1 Sunlight -> 2 Oxygen + 1 Energy\n");
+    RecipeReader reader(recipe, 64); // Small buffer to exercise refills
+
+    ExecutablePlan plan(nullptr, 0);
+    plan.Seed(5);
+    Stockpile stockpile;
+    stockpile.AddResource("Water", 4);
+    stockpile.AddResource("Carbon", 2);
+    stockpile.AddResource("Sunlight", 1);
+
+    StreamResult result = reader.Stream(plan, stockpile, 2);
+    std::cout << "Steps applied: " << result.stepsApplied
+              << ", failed step: " << result.failedStep
+              << ", formulas held: " << plan.GetSize() << std::endl;
+    std::cout << "Oxygen Quantity: " << stockpile.GetQuantity("Oxygen")
+              << ", Energy Quantity: " << stockpile.GetQuantity("Energy")
+              << std::endl;
+
+    std::istringstream malformed("1 Water -> 1 Ice\n2 Water Steam\n");
+    RecipeReader badReader(malformed);
+    try {
+        badReader.Stream(plan, stockpile);
+    } catch (const std::exception& e) {
+        std::cout << "Exception caught: " << e.what() << std::endl;
+    }
+}
+
+void Test_Stockpile_ApplyRepeatedly() {
+    std::cout << "\nTesting Applying a Formula Many Times at Once:\n";
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 10}}}
+    };
+    Formula* formulasArray = createFormulasArray(resources);
+    CompiledPlan program(formulasArray[0]);
+    delete[] formulasArray;
+    CompiledFormula formula = program.GetStep(0);
+
+    Stockpile stockpile;
+    stockpile.AddResource("Water", 2000);
+    stockpile.AddResource("Carbon", 700);
+
+    RandomStream rng(42);
+    std::int64_t runs = stockpile.ApplyRepeatedly(formula, 5000, rng);
+    double probabilities[TierCount];
+    Formula::TierProbabilities(0, probabilities);
+    double expected = 0;
+    for (int tier = 0; tier < TierCount; ++tier) {
+        expected += probabilities[tier] *
+                    AdjustQuantity(10, static_cast<MultiplierTier>(tier));
+    }
+    std::cout << "Runs applied: " << runs << " of " << 5000
+              << ", Water: " << stockpile.GetQuantity("Water")
+              << ", Carbon: " << stockpile.GetQuantity("Carbon")
+              << ", Glucose per run: "
+              << static_cast<double>(stockpile.GetQuantity("Glucose")) / runs
+              << " (expected " << expected << ")" << std::endl;
+
+    // A zero need of a never-stocked resource ahead of a short input must
+    // roll back cleanly
+    Stockpile scarce;
+    scarce.AddResource("Water", 1);
+    ResourceAmount shortTerms[] = {
+            {ResourceRegistry::Global().Intern("Phlogiston"), 0},
+            {ResourceRegistry::Global().Find("Water"), 5}};
+    CompiledFormula shortFormula{shortTerms, 2, shortTerms + 2, 0, 0, 0};
+    std::int64_t oneRun[TierCount] = {0, 0, 1, 0};
+    bool applied = scarce.TransactBatch(shortFormula, oneRun);
+
+    // Water named twice: 10 Water covers two runs of 2 + 2, not five
+    Stockpile twice;
+    twice.AddResource("Water", 10);
+    ResourceAmount twiceTerms[] = {{ResourceRegistry::Global().Find("Water"), 2},
+                                   {ResourceRegistry::Global().Find("Water"), 2}};
+    CompiledFormula twiceFormula{twiceTerms, 2, twiceTerms + 2, 0, 0, 0};
+    std::int64_t twiceRuns = twice.ApplyRepeatedly(twiceFormula, 5, rng);
+    std::cout << "Short batch applied: " << (applied ? "yes" : "no")
+              << ", Water left: " << scarce.GetQuantity("Water")
+              << ", repeated-input runs: " << twiceRuns << " (Water left "
+              << twice.GetQuantity("Water") << ")" << std::endl;
+}
+
+void Test_FeasibilityTable_MatchesTransact() {
+    std::cout << "\nTesting Bulk Feasibility of Many Formulas:\n";
+
+    // Formulas 0 and 1 need Water twice over, 2 produces from nothing,
+    // 3 needs a resource the stockpile has never seen
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 1}}},
+            {{{"Water", 5}, {"Carbon", 1}}, {{"Glucose", 1}}},
+            {{}, {{"Sunlight", 1}}},
+            {{{"Glucose", 1}, {"Unobtainium", 1}}, {{"Energy", 1}}},
+            {{{"Carbon", 3}}, {{"Energy", 1}}}
+    };
+    Formula* formulasArray = createFormulasArray(resources);
+    Plan plan(formulasArray, resources.size());
+    delete[] formulasArray;
+    std::shared_ptr<const CompiledPlan> program = plan.Compile();
+    FeasibilityTable table(*program);
+
+    Stockpile stockpile;
+    stockpile.AddResource("Water", 4);
+    stockpile.AddResource("Carbon", 3);
+
+    std::vector<std::uint64_t> mask;
+    std::vector<std::uint64_t> scalarMask;
+    table.Evaluate(stockpile, mask);
+    table.EvaluateScalar(stockpile, scalarMask);
+
+    std::cout << "Runnable formulas:";
+    bool matches = mask == scalarMask;
+    for (int i = 0; i < table.GetSize(); ++i) {
+        bool runnable = (mask[i / 64] >> (i % 64)) & 1;
+        matches = matches && runnable == (stockpile.MaxApplications(program->GetStep(i)) > 0);
+        if (runnable) {
+            std::cout << " " << i;
+        }
+    }
+    std::cout << ", SIMD: " << (FeasibilityTable::HasSimd() ? "yes" : "no")
+              << ", matches scalar and stock: " << (matches ? "yes" : "no") << std::endl;
+}
+
+void Test_ExecutablePlan_RunDoesNotAllocate() {
+    std::cout << "\nTesting That Executing Steps Does Not Allocate:\n";
+
+    // Names longer than any small-string buffer, so a copy would allocate
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Deionized Laboratory Water", 1}}, {{"Concentrated Glucose Syrup", 1}}},
+            {{{"Concentrated Glucose Syrup", 1}}, {{"Deionized Laboratory Water", 1}}}
+    };
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> repeated;
+    for (int i = 0; i < 50; ++i) {
+        repeated.insert(repeated.end(), resources.begin(), resources.end());
+    }
+    Formula* formulasArray = createFormulasArray(repeated);
+    ExecutablePlan plan(formulasArray, repeated.size());
+    delete[] formulasArray;
+    plan.Seed(9);
+
+    Stockpile stockpile;
+    stockpile.AddResource("Deionized Laboratory Water", 1000);
+    stockpile.AddResource("Concentrated Glucose Syrup", 1000);
+    // Compiling and sizing the log are one-time costs paid up front
+    plan.Compile();
+    stockpile.ReserveApplyLog(repeated.size(), repeated.size());
+
+    std::size_t before = AllocationCount.load();
+    long long seen = 0;
+    for (FormulaTerm input : plan.GetFormula(0).GetInputs()) {
+        seen += stockpile.GetQuantity(input.name) + input.name.size();
+    }
+    seen += stockpile.GetQuantity(plan.GetFormula(1).GetOutputName(0));
+    RunResult half = plan.RunSteps(stockpile, 50);
+    RunResult rest = plan.RunToCompletion(stockpile, false);
+    std::size_t allocations = AllocationCount.load() - before;
+
+    std::cout << "Steps applied: " << half.stepsApplied + rest.stepsApplied
+              << ", quantities seen: " << seen
+              << ", allocations: " << allocations << std::endl;
+}
+
+void Test_ExecutablePlan_ProficiencyProgression() {
+    std::cout << "\nTesting Proficiency Progression While Executing:\n";
+
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources{
+            {{{"Water", 1}}, {{"Glucose", 1}}}
+    };
+    Formula* formulasArray = createFormulasArray(resources);
+    Formula practiced = formulasArray[0];
+    delete[] formulasArray;
+
+    // Copies share the formula's identity, and with it its progress
+    ExecutablePlan tracked(nullptr, 0);
+    for (int i = 0; i < 300; ++i) {
+        tracked.Add(Formula(practiced));
+    }
+    tracked.Seed(21);
+    ExecutablePlan untracked = tracked;
+    tracked.TrackProficiency(true);
+
+    Stockpile trackedStock;
+    Stockpile untrackedStock;
+    trackedStock.AddResource("Water", 300);
+    untrackedStock.AddResource("Water", 300);
+    tracked.RunToCompletion(trackedStock);
+    untracked.RunToCompletion(untrackedStock);
+
+    // Until the fourth application both runs draw at level 0
+    const ApplyLog &trackedLog = trackedStock.GetApplyLog();
+    const ApplyLog &untrackedLog = untrackedStock.GetApplyLog();
+    bool sameStart = true;
+    for (std::size_t i = 0; i < LevelExperience[1]; ++i) {
+        sameStart = sameStart && trackedLog.GetRecord(i).tier == untrackedLog.GetRecord(i).tier;
+    }
+    const ProficiencyTracker &progress = *tracked.GetProficiency();
+    std::cout << "Experience: " << progress.GetExperience(practiced.GetId())
+              << ", level: " << progress.GetLevel(practiced.GetId(), 0)
+              << ", first steps unchanged: " << (sameStart ? "yes" : "no")
+              << ", Glucose tracked vs untracked: "
+              << trackedStock.GetQuantity("Glucose") << " vs "
+              << untrackedStock.GetQuantity("Glucose") << std::endl;
+}
+
+// A recipe book known at build time
+namespace photosynthesis {
+enum Slot { Water, Carbon, Glucose, Sunlight, Oxygen, Energy };
+using MakeGlucose = StaticFormula<
+        StaticInputs<StaticTerm<Water, 2>, StaticTerm<Carbon, 1>>,
+        StaticOutputs<StaticTerm<Glucose, 1>>>;
+using BurnGlucose = StaticFormula<
+        StaticInputs<StaticTerm<Glucose, 1>, StaticTerm<Sunlight, 1>>,
+        StaticOutputs<StaticTerm<Oxygen, 2>, StaticTerm<Energy, 1>>>;
+using Book = StaticRecipeBook<6, MakeGlucose, BurnGlucose>;
+} // namespace photosynthesis
+
+void Test_StaticRecipeBook_MatchesRuntime() {
+    std::cout << "\nTesting Compile-Time Formulas Against Runtime Execution:\n";
+    using namespace photosynthesis;
+    Book book("Water", "Carbon", "Glucose", "Sunlight", "Oxygen", "Energy");
+
+    // Static recipes mixed with one the book does not know
+    ExecutablePlan plan(nullptr, 0);
+    Formula makeGlucose = book.ToFormula<MakeGlucose>();
+    Formula burnGlucose = book.ToFormula<BurnGlucose>();
+    Formula evaporate = createFormula({{"Water", 1}}, {{"Steam", 1}});
+    for (int i = 0; i < 40; ++i) {
+        plan.Add(Formula(makeGlucose));
+        plan.Add(Formula(i % 4 == 0 ? evaporate : burnGlucose));
+    }
+    std::shared_ptr<const CompiledPlan> program = plan.Compile();
+    std::vector<std::uint8_t> kinds = book.Classify(*program);
+
+    Stockpile runtimeStock;
+    Stockpile staticStock;
+    for (Stockpile *stockpile : {&runtimeStock, &staticStock}) {
+        stockpile->AddResource("Water", 90);
+        stockpile->AddResource("Carbon", 40);
+        stockpile->AddResource("Sunlight", 25);
+        stockpile->AddResource("Glucose", 20);
+        stockpile->Reserve(program->GetResourceBound());
+    }
+    RunResult runtimeResult = program->Execute(0, program->GetSize(), runtimeStock, 3, true);
+    RunResult staticResult = book.Execute(*program, kinds, 0, program->GetSize(),
+                                          staticStock, 3, true);
+
+    int staticSteps = 0;
+    for (std::uint8_t kind : kinds) {
+        staticSteps += kind != Book::Runtime;
+    }
+    bool same = runtimeResult.stepsApplied == staticResult.stepsApplied &&
+                runtimeResult.failedStep == staticResult.failedStep &&
+                runtimeStock.GetApplyResults() == staticStock.GetApplyResults();
+    for (std::size_t id = 0; id < runtimeStock.GetResourceBound(); ++id) {
+        same = same && runtimeStock.GetQuantity(static_cast<ResourceId>(id)) ==
+                       staticStock.GetQuantity(static_cast<ResourceId>(id));
+    }
+    std::cout << "Static steps: " << staticSteps << " of " << kinds.size()
+              << ", steps applied: " << staticResult.stepsApplied
+              << ", failed step: " << staticResult.failedStep
+              << ", matches runtime: " << (same ? "yes" : "no") << std::endl;
+}
+
+void Test_ConcurrentStockpile_ProductionLines() {
+    std::cout << "\nTesting Production Lines Sharing a Concurrent Stockpile:\n";
+
+    // Every line smelts one Ore per step; there is Ore for 500 of 800 steps
+    Formula smelt = createFormula({{"Ore", 1}, {"Coal", 1}}, {{"Ingot", 1}});
+    const int lines = 8;
+    const int steps = 100;
+    std::vector<ExecutablePlan> plans;
+    for (int line = 0; line < lines; ++line) {
+        plans.emplace_back(nullptr, 0);
+        for (int i = 0; i < steps; ++i) {
+            plans.back().Add(Formula(smelt));
+        }
+        plans.back().Seed(100 + line);
+        plans.back().Compile();
+    }
+
+    ConcurrentStockpile shared(ResourceRegistry::Global().Size());
+    shared.AddResource("Ore", 500);
+    shared.AddResource("Coal", 1300);
+    std::vector<int> applied(lines);
+    std::vector<std::thread> workers;
+    for (int line = 0; line < lines; ++line) {
+        workers.emplace_back([&, line] {
+            // A line stops only when the Ore is truly gone
+            applied[line] = plans[line].RunToCompletion(shared).stepsApplied;
+        });
+    }
+    // Lock-free consumes race the lines' Transacts for the Coal
+    int skimmed = 0;
+    workers.emplace_back([&] {
+        for (int i = 0; i < 300; ++i) {
+            skimmed += shared.ConsumeResource("Coal", 1) ? 1 : 0;
+        }
+    });
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    int total = 0;
+    for (int count : applied) {
+        total += count;
+    }
+    std::cout << "Steps applied: " << total
+              << ", Ore left: " << shared.GetQuantity("Ore")
+              << ", Coal left: " << shared.GetQuantity("Coal")
+              << ", Coal skimmed: " << skimmed
+              << ", Ingots: " << (shared.GetQuantity("Ingot") > 0 ? "some" : "none")
+              << std::endl;
+}
+
+void Test_ShardedStockpile_Epochs() {
+    std::cout << "\nTesting Sharded Stockpile Deltas Merged per Epoch:\n";
+
+    Formula smelt = createFormula({{"Ore", 1}, {"Coal", 1}}, {{"Ingot", 1}});
+    const int lines = 4;
+    std::vector<ExecutablePlan> plans;
+    for (int line = 0; line < lines; ++line) {
+        plans.emplace_back(nullptr, 0);
+        for (int i = 0; i < 200; ++i) {
+            plans.back().Add(Formula(smelt));
+        }
+        plans.back().Seed(200 + line);
+        plans.back().Compile();
+    }
+
+    // Each epoch runs half of every line, then merges the shards
+    Stockpile master;
+    master.AddResource("Ore", 1000);
+    master.AddResource("Coal", 1000);
+    ShardedStockpile sharded(master, ResourceRegistry::Global().Size(), 16);
+    std::vector<StockpileShard *> shards;
+    for (int line = 0; line < lines; ++line) {
+        shards.push_back(&sharded.CreateShard());
+    }
+    std::cout << "Ore after each epoch:";
+    for (int epoch = 0; epoch < 2; ++epoch) {
+        std::vector<std::thread> workers;
+        for (int line = 0; line < lines; ++line) {
+            workers.emplace_back([&, line] { plans[line].RunSteps(*shards[line], 100); });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        sharded.EndEpoch();
+        std::cout << " " << master.GetQuantity("Ore");
+    }
+
+    // Every line applied all its steps, so replaying each alone gives the
+    // same Ingots
+    int serialIngots = 0;
+    for (int line = 0; line < lines; ++line) {
+        ExecutablePlan replay(nullptr, 0);
+        for (int i = 0; i < 200; ++i) {
+            replay.Add(Formula(smelt));
+        }
+        replay.Seed(200 + line);
+        Stockpile lineStock;
+        lineStock.AddResource("Ore", 200);
+        lineStock.AddResource("Coal", 200);
+        replay.RunToCompletion(lineStock, false);
+        serialIngots += lineStock.GetQuantity("Ingot");
+    }
+
+    // Scarce stock: shards hold reservations, but never more than exists
+    Stockpile scarce;
+    scarce.AddResource("Ore", 10);
+    ShardedStockpile scarceSharded(scarce, ResourceRegistry::Global().Size(), 4);
+    StockpileShard &first = scarceSharded.CreateShard();
+    StockpileShard &second = scarceSharded.CreateShard();
+    ResourceId ore = ResourceRegistry::Global().Find("Ore");
+    bool firstTook = first.ConsumeResource(ore, 3);   // Reserves 3 + 4
+    bool secondTook = second.ConsumeResource(ore, 4); // Only 3 are left
+    scarceSharded.EndEpoch();
+
+    std::cout << ", Ingots: " << master.GetQuantity("Ingot") << " (serial "
+              << serialIngots << ")"
+              << ", scarce consumes: " << (firstTook ? "yes" : "no") << " "
+              << (secondTook ? "yes" : "no")
+              << ", Ore left: " << scarce.GetQuantity("Ore") << std::endl;
+}
+
+void Test_ProductionSimulator_Makespan() {
+    std::cout << "\nTesting Discrete-Event Production on Machine Pools:\n";
+
+    // Smelting feeds forging: two furnaces, one slower anvil
+    Formula smelt = createFormula({{"Ore", 1}, {"Coal", 1}}, {{"Ingot", 4}});
+    Formula forge = createFormula({{"Ingot", 3}}, {{"Tool", 2}});
+    smelt.SetProficiencyLevel(6);
+    forge.SetProficiencyLevel(6);
+    Plan plan(nullptr, 0);
+    for (int i = 0; i < 20; ++i) {
+        plan.Add(Formula(smelt));
+        plan.Add(Formula(forge));
+    }
+    std::shared_ptr<const CompiledPlan> program = plan.Compile();
+
+    ProductionSimulator factory(program);
+    int furnaces = factory.AddPool(2);
+    int anvils = factory.AddPool(1);
+    factory.SetTiming(smelt.GetId(), furnaces, 3);
+    factory.SetTiming(forge.GetId(), anvils, 5);
+
+    Stockpile simulated;
+    simulated.AddResource("Ore", 30);
+    simulated.AddResource("Coal", 30);
+    ProductionReport report = factory.Run(simulated, 9);
+
+    // Timing never changes the outcome, only when it happens
+    Stockpile serial;
+    serial.AddResource("Ore", 30);
+    serial.AddResource("Coal", 30);
+    RunResult result = program->Execute(0, program->GetSize(), serial, 9, false);
+
+    std::cout << "Makespan: " << report.makespan << ", steps: "
+              << report.stepsCompleted << " (serial " << result.stepsApplied << ")"
+              << ", events: " << report.events << std::endl;
+    std::cout << "Utilization furnaces: " << report.utilization[furnaces]
+              << ", anvils: " << report.utilization[anvils] << std::endl;
+    std::cout << "Tools: " << simulated.GetQuantity("Tool") << " (serial "
+              << serial.GetQuantity("Tool") << "), Ingots: "
+              << simulated.GetQuantity("Ingot") << " (serial "
+              << serial.GetQuantity("Ingot") << ")" << std::endl;
+}
+
+void Test_PlanAnalyzer_Bounds() {
+    std::cout << "\nTesting Static Feasibility and Bottleneck Analysis:\n";
+
+    // Glucose made early is spent later, so it depends on the draws
+    std::vector<std::pair<std::map<std::string, int>, std::map<std::string, int>>> resources(
+            10, {{{"Water", 2}, {"Carbon", 1}}, {{"Glucose", 10}}});
+    resources.insert(resources.end(), 5, {{{"Glucose", 8}}, {{"Energy", 1}}});
+    Formula* formulasArray = createFormulasArray(resources);
+    Plan plan(formulasArray, resources.size());
+    delete[] formulasArray;
+    std::shared_ptr<const CompiledPlan> program = plan.Compile();
+    PlanAnalyzer analyzer(program);
+
+    Stockpile initial;
+    initial.AddResource("Water", 20);
+    initial.AddResource("Carbon", 10);
+    PlanAnalysis analysis = analyzer.Analyze(initial);
+    ResourceId glucose = ResourceRegistry::Global().Find("Glucose");
+    const ResourceBounds &bounds = analysis.resources[glucose];
+    std::cout << "First risky step: " << analysis.firstRiskyStep << " (short of "
+              << ResourceRegistry::Global().Name(analysis.riskyResource)
+              << "), first failing step: " << analysis.firstFailingStep << std::endl;
+    std::cout << "Glucose worst: " << bounds.worst << ", best: " << bounds.best
+              << ", required stock: " << bounds.requiredStock << std::endl;
+
+    // Starting at the required stock, no seed can make the plan fail
+    initial.AddResource("Glucose", static_cast<int>(bounds.requiredStock));
+    int completed = 0;
+    for (std::uint64_t seed = 0; seed < 50; ++seed) {
+        Stockpile run;
+        run.AddResource("Water", 20);
+        run.AddResource("Carbon", 10);
+        run.AddResource("Glucose", static_cast<int>(bounds.requiredStock));
+        completed += program->Execute(0, program->GetSize(), run, seed, false)
+                             .failedStep < 0;
+    }
+    Stockpile dry;
+    dry.AddResource("Water", 10);
+    dry.AddResource("Carbon", 10);
+    PlanAnalysis stocked = analyzer.Analyze(initial);
+    std::cout << "Guaranteed: " << (stocked.IsGuaranteed() ? "yes" : "no")
+              << ", risky resource: "
+              << (stocked.riskyResource == InvalidResource ? "none" : "some")
+              << ", runs completed: " << completed << "/50"
+              << ", first failing step without Water: "
+              << analyzer.Analyze(dry).firstFailingStep << std::endl;
+}
+
+void Test_PlanSynthesizer_ShortestPlan() {
+    std::cout << "\nTesting Plan Synthesis Toward a Target Stockpile:\n";
+
+    // A gear takes two plates and an ingot; coal comes from wood or ore.
+    // The shortest route is 1 + 2 coal, 4 smelts, 2 plates and the gear.
+    std::vector<Formula> library = {
+            createFormula({{"Ore", 1}, {"Coal", 1}}, {{"Ingot", 2}}),
+            createFormula({{"Ingot", 3}}, {{"Plate", 1}}),
+            createFormula({{"Plate", 2}, {"Ingot", 1}}, {{"Gear", 1}}),
+            createFormula({{"Ore", 2}}, {{"Coal", 1}}),
+            createFormula({{"Wood", 1}}, {{"Coal", 2}}),
+            createFormula({{"Ingot", 1}}, {{"Ore", 1}}),
+            createFormula({{"Plate", 1}}, {{"Ingot", 2}})};
+    for (Formula &formula : library) {
+        formula.SetProficiencyLevel(Formula::MaxProficiency);
+    }
+    SynthesisOptions options;
+    options.worstCase = true;
+    PlanSynthesizer synthesizer(library, options);
+
+    Stockpile initial;
+    initial.AddResource("Ore", 10);
+    initial.AddResource("Wood", 1);
+    Stockpile target;
+    target.AddResource("Gear", 1);
+    SynthesisResult result = synthesizer.Search(initial, target);
+
+    std::cout << "Found: " << (result.found ? "yes" : "no") << ", optimal: "
+              << (result.optimal ? "yes" : "no") << ", steps: " << result.steps.size()
+              << ", expanded: " << result.expanded << ", plan:";
+    for (int step : result.steps) {
+        std::cout << " " << step;
+    }
+    std::cout << std::endl;
+
+    // Planned at the worst reachable tiers, so every run gets the gear
+    Plan plan = synthesizer.BuildPlan(result);
+    std::shared_ptr<const CompiledPlan> program = plan.Compile();
+    int reached = 0;
+    for (std::uint64_t seed = 0; seed < 20; ++seed) {
+        Stockpile run;
+        run.AddResource("Ore", 10);
+        run.AddResource("Wood", 1);
+        program->Execute(0, program->GetSize(), run, seed, false);
+        reached += run.GetQuantity("Gear") >= 1;
+    }
+    options.threads = 4;
+    options.batchSize = 3;
+    SynthesisResult threaded = PlanSynthesizer(library, options).Search(initial, target);
+    Stockpile impossible;
+    impossible.AddResource("Tool", 1);
+    // No formula touches the Hammer, so only the starting stock can meet it
+    initial.AddResource("Hammer", 1);
+    target.AddResource("Hammer", 1);
+    SynthesisResult held = synthesizer.Search(initial, target);
+    std::cout << "Runs reaching the target: " << reached << "/20"
+              << ", same length in batches of 3: "
+              << (threaded.steps.size() == result.steps.size() ? "yes" : "no")
+              << ", unreachable target found: "
+              << (synthesizer.Search(initial, impossible).found ? "yes" : "no")
+              << ", held target same length: "
+              << (held.found && held.steps.size() == result.steps.size() ? "yes" : "no")
+              << std::endl;
+}
+
 int main() {
     Test_Formula_Apply();
     Test_Stockpile_AddResource();
     Test_ExecutablePlan_ApplyCurrentFormula();
     Test_Formula_InsufficientResources();
     Test_ExecutablePlan_ReplaceFormula();
+    Test_ExecutablePlan_RunToCompletion();
+    Test_EnsembleRunner_Run();
+    Test_PlanScheduler_MatchesSequential();
+    Test_ExpectedYield_MatchesEnsemble();
+    Test_Plan_CopyOnWriteFork();
+    Test_Stockpile_CheckpointRollback();
+    Test_PlanArchive_RoundTrip();
+    Test_RecipeReader_Stream();
+    Test_Stockpile_ApplyRepeatedly();
+    Test_FeasibilityTable_MatchesTransact();
+    Test_ExecutablePlan_RunDoesNotAllocate();
+    Test_ExecutablePlan_ProficiencyProgression();
+    Test_StaticRecipeBook_MatchesRuntime();
+    Test_ConcurrentStockpile_ProductionLines();
+    Test_ShardedStockpile_Epochs();
+    Test_ProductionSimulator_Makespan();
+    Test_PlanAnalyzer_Bounds();
+    Test_PlanSynthesizer_ShortestPlan();
     return 0;
 }
 
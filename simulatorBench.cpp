@@ -0,0 +1,995 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: simulatorBench.cpp
+// DATE:     10/15/2026
+// DESCRIPTION: Microbenchmarks for the simulator's hot paths. The harness
+//              mirrors Google Benchmark's interface (range-for over a State,
+//              parameterized registrations, --benchmark_filter,
+//              --benchmark_min_time and --benchmark_format=json with the
+//              same JSON schema) without depending on the library, so
+//              results can be diffed by the same tooling.
+//
+// Usage: simulator_bench [--benchmark_filter=<regex>]
+//                        [--benchmark_min_time=<seconds>]
+//                        [--benchmark_format=console|json]
+
+#include "concurrentStockpile.h"
+#include "executablePlan.h"
+#include "feasibilityTable.h"
+#include "formula.h"
+#include "plan.h"
+#include "planAnalyzer.h"
+#include "planArchive.h"
+#include "planSynthesizer.h"
+#include "productionSimulator.h"
+#include "recipeReader.h"
+#include "shardedStockpile.h"
+#include "staticFormula.h"
+#include "stockpile.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// Keeps the optimizer from discarding 'value' without costing a store.
+template <typename T>
+inline void DoNotOptimize(T const &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+class State {
+public:
+    State(std::int64_t iterations, std::vector<std::int64_t> args)
+            : iterations(iterations), args(std::move(args)) {}
+
+    std::int64_t range(std::size_t index) const { return args[index]; }
+    std::int64_t max_iterations() const { return iterations; }
+    void SetItemsProcessed(std::int64_t items) { itemsProcessed = items; }
+    std::int64_t items_processed() const { return itemsProcessed; }
+
+    // Only time between ResumeTiming and PauseTiming is measured
+    void ResumeTiming() {
+        realStart = std::chrono::steady_clock::now();
+        cpuStart = std::clock();
+    }
+    void PauseTiming() {
+        cpuSeconds += static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        realSeconds += std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - realStart).count();
+    }
+    double real_seconds() const { return realSeconds; }
+    double cpu_seconds() const { return cpuSeconds; }
+
+    // Non-trivial so that the unused loop variable draws no warning
+    struct Value {
+        ~Value() {}
+    };
+
+    // Counting iterator so that "for (auto _ : state)" times just the loop
+    struct Iterator {
+        State *state;
+        std::int64_t remaining;
+        bool operator!=(const Iterator &) const {
+            if (remaining != 0) {
+                return true;
+            }
+            state->PauseTiming();
+            return false;
+        }
+        void operator++() { --remaining; }
+        Value operator*() const { return Value(); }
+    };
+    Iterator begin() {
+        ResumeTiming();
+        return Iterator{this, iterations};
+    }
+    Iterator end() { return Iterator{this, 0}; }
+
+private:
+    std::int64_t iterations;
+    std::vector<std::int64_t> args;
+    std::int64_t itemsProcessed = 0;
+    std::chrono::steady_clock::time_point realStart;
+    std::clock_t cpuStart = 0;
+    double realSeconds = 0;
+    double cpuSeconds = 0;
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void(State &)> function;
+    std::vector<std::vector<std::int64_t>> argSets;
+};
+
+std::vector<Benchmark> &Registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct Registrar {
+    Registrar(const char *name, void (*function)(State &),
+              std::vector<std::vector<std::int64_t>> argSets = {{}}) {
+        Registry().push_back(Benchmark{name, function, std::move(argSets)});
+    }
+};
+
+struct Result {
+    std::string name;
+    std::int64_t iterations;
+    double realNs;
+    double cpuNs;
+    double itemsPerSecond;
+};
+
+Result RunOne(const Benchmark &benchmark, const std::vector<std::int64_t> &args,
+              double minTime) {
+    std::string name = benchmark.name;
+    for (std::int64_t arg : args) {
+        name += "/" + std::to_string(arg);
+    }
+
+    // Grow the iteration count until one run lasts at least minTime
+    std::int64_t iterations = 1;
+    for (;;) {
+        State state(iterations, args);
+        benchmark.function(state);
+        double cpu = state.cpu_seconds();
+        double real = state.real_seconds();
+
+        if (real >= minTime || iterations >= 1000000000) {
+            double items = static_cast<double>(state.items_processed());
+            return Result{name, iterations, real * 1e9 / iterations,
+                          cpu * 1e9 / iterations, real > 0 ? items / real : 0};
+        }
+        double scale = real > 0 ? 1.4 * minTime / real : 100.0;
+        iterations = static_cast<std::int64_t>(std::ceil(
+                iterations * std::min(std::max(scale, 2.0), 100.0)));
+    }
+}
+
+int RunAll(int argc, char **argv) {
+    std::regex filter(".*");
+    double minTime = 0.2;
+    bool json = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--benchmark_filter=", 0) == 0) {
+            filter = std::regex(arg.substr(19));
+        } else if (arg.rfind("--benchmark_min_time=", 0) == 0) {
+            minTime = std::stod(arg.substr(21));
+        } else if (arg == "--benchmark_format=json") {
+            json = true;
+        } else if (arg != "--benchmark_format=console") {
+            std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    if (!json) {
+        std::printf("%-44s %14s %14s %12s %14s\n", "Benchmark", "Time (ns)",
+                    "CPU (ns)", "Iterations", "Items/s");
+    }
+    for (const Benchmark &benchmark : Registry()) {
+        for (const auto &args : benchmark.argSets) {
+            std::string name = benchmark.name;
+            for (std::int64_t arg : args) {
+                name += "/" + std::to_string(arg);
+            }
+            if (!std::regex_search(name, filter)) {
+                continue;
+            }
+            Result result = RunOne(benchmark, args, minTime);
+            if (!json) {
+                std::printf("%-44s %14.1f %14.1f %12lld %14.4g\n",
+                            result.name.c_str(), result.realNs, result.cpuNs,
+                            static_cast<long long>(result.iterations),
+                            result.itemsPerSecond);
+                std::fflush(stdout);
+            }
+            results.push_back(result);
+        }
+    }
+
+    if (json) {
+        char date[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        std::printf("{\n  \"context\": {\n    \"date\": \"%s\",\n"
+                    "    \"num_cpus\": %u,\n    \"library_build_type\": \"%s\"\n"
+                    "  },\n  \"benchmarks\": [\n", date,
+                    std::thread::hardware_concurrency(),
+#ifdef NDEBUG
+                    "release"
+#else
+                    "debug"
+#endif
+        );
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result &r = results[i];
+            std::printf("    {\n      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n"
+                        "      \"run_type\": \"iteration\",\n"
+                        "      \"iterations\": %lld,\n      \"real_time\": %.6e,\n"
+                        "      \"cpu_time\": %.6e,\n      \"time_unit\": \"ns\",\n"
+                        "      \"items_per_second\": %.6e\n    }%s\n",
+                        r.name.c_str(), r.name.c_str(),
+                        static_cast<long long>(r.iterations), r.realNs, r.cpuNs,
+                        r.itemsPerSecond, i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+    return 0;
+}
+
+} // namespace bench
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+#define BENCHMARK(function, ...)                                                \
+    static bench::Registrar BENCHMARK_CONCAT(registrar_, __LINE__)(            \
+            #function, function, ##__VA_ARGS__)
+
+// =============================================================================
+// ------------------------------- FIXTURES ------------------------------------
+// =============================================================================
+
+static const std::vector<std::vector<std::int64_t>> ResourceCounts =
+        {{8}, {64}, {1024}, {16384}};
+static const std::vector<std::vector<std::int64_t>> PlanLengths =
+        {{1000}, {10000}, {100000}};
+
+static std::string ResourceName(std::int64_t index) {
+    return "Bench" + std::to_string(index);
+}
+
+// Builds a two-input, one-output formula over a pool of 'resources' names
+static Formula MakeFormula(std::int64_t seed, std::int64_t resources) {
+    std::string *inputNames = new std::string[2]{
+            ResourceName(seed % resources), ResourceName((seed * 7 + 1) % resources)};
+    int *inputQuantities = new int[2]{1, 1};
+    std::string *outputNames = new std::string[1]{
+            ResourceName((seed * 13 + 5) % resources)};
+    int *outputQuantities = new int[1]{2};
+    return Formula(inputNames, inputQuantities, 2, outputNames,
+                   outputQuantities, 1);
+}
+
+static ExecutablePlan MakePlan(std::int64_t length, std::int64_t resources) {
+    Formula first = MakeFormula(0, resources);
+    ExecutablePlan plan(&first, 1);
+    for (std::int64_t i = 1; i < length; ++i) {
+        plan.Add(MakeFormula(i, resources));
+    }
+    return plan;
+}
+
+// A stockpile deep enough that every step of a MakePlan plan applies
+static void FillStockpile(Stockpile &stockpile, std::int64_t resources,
+                          std::int64_t perResource) {
+    for (std::int64_t r = 0; r < resources; ++r) {
+        stockpile.AddResource(ResourceName(r), static_cast<int>(perResource));
+    }
+}
+
+// IDs of the first 'resources' bench names. Other fixtures intern some of
+// the names first, so the IDs are not consecutive.
+static std::vector<ResourceId> ResourceIds(std::int64_t resources) {
+    std::vector<ResourceId> ids;
+    for (std::int64_t r = 0; r < resources; ++r) {
+        ids.push_back(ResourceRegistry::Global().Intern(ResourceName(r)));
+    }
+    return ids;
+}
+
+// =============================================================================
+// ------------------------------ BENCHMARKS -----------------------------------
+// =============================================================================
+
+static void BM_FormulaApply(bench::State &state) {
+    Formula formula = MakeFormula(1, 64);
+    RandomStream rng;
+    for (auto _ : state) {
+        bench::DoNotOptimize(formula.Apply(rng));
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_FormulaApply);
+
+static void BM_DetermineMultiplier(bench::State &state) {
+    int level = static_cast<int>(state.range(0));
+    RandomStream rng;
+    for (auto _ : state) {
+        bench::DoNotOptimize(Formula::DetermineMultiplier(level, rng));
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_DetermineMultiplier, {{0}, {Formula::MaxProficiency}});
+
+static void BM_StockpileAddResource(bench::State &state) {
+    std::int64_t resources = state.range(0);
+    Stockpile stockpile;
+    FillStockpile(stockpile, resources, 0);
+    std::vector<ResourceId> ids = ResourceIds(resources);
+    std::int64_t i = 0;
+    for (auto _ : state) {
+        stockpile.AddResource(ids[i++ % resources], 1);
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_StockpileAddResource, ResourceCounts);
+
+static void BM_StockpileAddResourceByName(bench::State &state) {
+    std::int64_t resources = state.range(0);
+    Stockpile stockpile;
+    std::vector<std::string> names;
+    for (std::int64_t r = 0; r < resources; ++r) {
+        names.push_back(ResourceName(r));
+    }
+    std::int64_t i = 0;
+    for (auto _ : state) {
+        stockpile.AddResource(names[i++ % resources], 1);
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_StockpileAddResourceByName, ResourceCounts);
+
+static void BM_StockpileConsumeResource(bench::State &state) {
+    std::int64_t resources = state.range(0);
+    Stockpile stockpile;
+    FillStockpile(stockpile, resources, 1 << 30);
+    std::vector<ResourceId> ids = ResourceIds(resources);
+    std::int64_t i = 0;
+    for (auto _ : state) {
+        bench::DoNotOptimize(stockpile.ConsumeResource(ids[i++ % resources], 1));
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_StockpileConsumeResource, ResourceCounts);
+
+static void BM_StockpileGetQuantity(bench::State &state) {
+    std::int64_t resources = state.range(0);
+    Stockpile stockpile;
+    FillStockpile(stockpile, resources, 1);
+    std::vector<ResourceId> ids = ResourceIds(resources);
+    std::int64_t i = 0;
+    for (auto _ : state) {
+        bench::DoNotOptimize(stockpile.GetQuantity(ids[i++ % resources]));
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_StockpileGetQuantity, ResourceCounts);
+
+static void BM_StockpileGetQuantityByName(bench::State &state) {
+    std::int64_t resources = state.range(0);
+    Stockpile stockpile;
+    FillStockpile(stockpile, resources, 1);
+    std::vector<std::string> names;
+    for (std::int64_t r = 0; r < resources; ++r) {
+        names.push_back(ResourceName(r));
+    }
+    std::int64_t i = 0;
+    for (auto _ : state) {
+        bench::DoNotOptimize(stockpile.GetQuantity(names[i++ % resources]));
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_StockpileGetQuantityByName, ResourceCounts);
+
+// Explores a short branch and backs it out; the cost should not grow with
+// the number of resources in the stockpile
+static void BM_StockpileCheckpointRollback(bench::State &state) {
+    std::int64_t resources = state.range(0);
+    ExecutablePlan plan = MakePlan(16, resources);
+    Stockpile stockpile;
+    FillStockpile(stockpile, resources, 1 << 30);
+    for (auto _ : state) {
+        StockpileCheckpoint checkpoint = stockpile.Checkpoint();
+        ExecutablePlan branch(plan);
+        bench::DoNotOptimize(branch.RunToCompletion(stockpile));
+        stockpile.RollbackTo(checkpoint);
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_StockpileCheckpointRollback, ResourceCounts);
+
+// The same branch, restored by rebuilding the stockpile from scratch
+static void BM_StockpileRebuild(bench::State &state) {
+    std::int64_t resources = state.range(0);
+    ExecutablePlan plan = MakePlan(16, resources);
+    for (auto _ : state) {
+        Stockpile stockpile;
+        FillStockpile(stockpile, resources, 1 << 30);
+        ExecutablePlan branch(plan);
+        bench::DoNotOptimize(branch.RunToCompletion(stockpile));
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_StockpileRebuild, ResourceCounts);
+
+// Applies one formula k times with a tier draw and a Transact per run
+static void BM_StockpileTransactLoop(bench::State &state) {
+    std::int64_t runs = state.range(0);
+    Formula formula = MakeFormula(1, 64);
+    CompiledPlan program(formula);
+    CompiledFormula step = program.GetStep(0);
+    Stockpile stockpile;
+    FillStockpile(stockpile, 64, 1 << 30);
+    RandomStream rng;
+    for (auto _ : state) {
+        for (std::int64_t i = 0; i < runs; ++i) {
+            bench::DoNotOptimize(stockpile.Transact(
+                    step, Formula::DetermineMultiplier(step.proficiencyLevel, rng)));
+        }
+        if (stockpile.MaxApplications(step) < runs) {
+            FillStockpile(stockpile, 64, 1 << 30); // Rare; cheaper than pausing
+        }
+    }
+    state.SetItemsProcessed(state.max_iterations() * runs);
+}
+BENCHMARK(BM_StockpileTransactLoop, {{1}, {64}, {4096}});
+
+// The same k runs as one batch with multinomial tier counts
+static void BM_StockpileApplyRepeatedly(bench::State &state) {
+    std::int64_t runs = state.range(0);
+    Formula formula = MakeFormula(1, 64);
+    CompiledPlan program(formula);
+    CompiledFormula step = program.GetStep(0);
+    Stockpile stockpile;
+    FillStockpile(stockpile, 64, 1 << 30);
+    RandomStream rng;
+    for (auto _ : state) {
+        bench::DoNotOptimize(stockpile.ApplyRepeatedly(step, runs, rng));
+        if (stockpile.MaxApplications(step) < runs) {
+            FillStockpile(stockpile, 64, 1 << 30); // Rare; cheaper than pausing
+        }
+    }
+    state.SetItemsProcessed(state.max_iterations() * runs);
+}
+BENCHMARK(BM_StockpileApplyRepeatedly, {{1}, {64}, {4096}});
+
+// Contention: state.range(0) threads each apply TransactsPerThread formulas
+// over state.range(1) resources to one shared stockpile. Thread start-up is
+// timed too, equally for both variants.
+namespace contention {
+constexpr int TransactsPerThread = 4096;
+constexpr std::int64_t Depth = std::int64_t{1} << 40;
+
+template <typename Body>
+void RunThreads(std::int64_t threads, Body body) {
+    std::vector<std::thread> workers;
+    for (std::int64_t t = 0; t < threads; ++t) {
+        workers.emplace_back(body, t);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<const CompiledPlan> MakeFormulas(std::int64_t resources) {
+    return MakePlan(64, resources).Compile();
+}
+} // namespace contention
+
+// The workaround callers use today: one mutex around a plain Stockpile
+static void BM_StockpileGlobalMutex(bench::State &state) {
+    using namespace contention;
+    std::int64_t threads = state.range(0);
+    std::shared_ptr<const CompiledPlan> formulas = MakeFormulas(state.range(1));
+    Stockpile stockpile;
+    stockpile.Reserve(formulas->GetResourceBound());
+    for (std::size_t id = 0; id < formulas->GetResourceBound(); ++id) {
+        stockpile.AddResource(static_cast<ResourceId>(id), Depth);
+    }
+    std::mutex mutex;
+    for (auto _ : state) {
+        RunThreads(threads, [&](std::int64_t t) {
+            RandomStream rng(1, static_cast<std::uint64_t>(t));
+            for (int i = 0; i < TransactsPerThread; ++i) {
+                CompiledFormula step = formulas->GetStep((t + i) % formulas->GetSize());
+                MultiplierTier tier = Formula::DetermineMultiplier(0, rng);
+                std::lock_guard<std::mutex> lock(mutex);
+                bench::DoNotOptimize(stockpile.Transact(step, tier));
+            }
+        });
+    }
+    state.SetItemsProcessed(state.max_iterations() * threads * TransactsPerThread);
+}
+BENCHMARK(BM_StockpileGlobalMutex, {{1, 64}, {2, 64}, {4, 64}, {8, 64}, {16, 64},
+                                    {32, 64}, {64, 64}, {8, 2}, {64, 2}});
+
+static void BM_ConcurrentStockpileTransact(bench::State &state) {
+    using namespace contention;
+    std::int64_t threads = state.range(0);
+    std::shared_ptr<const CompiledPlan> formulas = MakeFormulas(state.range(1));
+    ConcurrentStockpile stockpile(formulas->GetResourceBound());
+    for (std::size_t id = 0; id < formulas->GetResourceBound(); ++id) {
+        stockpile.AddResource(static_cast<ResourceId>(id), Depth);
+    }
+    for (auto _ : state) {
+        RunThreads(threads, [&](std::int64_t t) {
+            RandomStream rng(1, static_cast<std::uint64_t>(t));
+            for (int i = 0; i < TransactsPerThread; ++i) {
+                CompiledFormula step = formulas->GetStep((t + i) % formulas->GetSize());
+                bench::DoNotOptimize(stockpile.Transact(
+                        step, Formula::DetermineMultiplier(0, rng)));
+            }
+        });
+    }
+    state.SetItemsProcessed(state.max_iterations() * threads * TransactsPerThread);
+}
+BENCHMARK(BM_ConcurrentStockpileTransact, {{1, 64}, {2, 64}, {4, 64}, {8, 64}, {16, 64},
+                                           {32, 64}, {64, 64}, {8, 2}, {64, 2}});
+
+// Same workload through per-thread shards, merged once per iteration
+static void BM_ShardedStockpileTransact(bench::State &state) {
+    using namespace contention;
+    std::int64_t threads = state.range(0);
+    std::shared_ptr<const CompiledPlan> formulas = MakeFormulas(state.range(1));
+    Stockpile master;
+    master.Reserve(formulas->GetResourceBound());
+    for (std::size_t id = 0; id < formulas->GetResourceBound(); ++id) {
+        master.AddResource(static_cast<ResourceId>(id), Depth);
+    }
+    ShardedStockpile sharded(master, formulas->GetResourceBound());
+    std::vector<StockpileShard *> shards;
+    for (std::int64_t t = 0; t < threads; ++t) {
+        shards.push_back(&sharded.CreateShard());
+    }
+    for (auto _ : state) {
+        RunThreads(threads, [&](std::int64_t t) {
+            RandomStream rng(1, static_cast<std::uint64_t>(t));
+            for (int i = 0; i < TransactsPerThread; ++i) {
+                CompiledFormula step = formulas->GetStep((t + i) % formulas->GetSize());
+                bench::DoNotOptimize(shards[t]->Transact(
+                        step, Formula::DetermineMultiplier(0, rng)));
+            }
+        });
+        sharded.EndEpoch();
+    }
+    state.SetItemsProcessed(state.max_iterations() * threads * TransactsPerThread);
+}
+BENCHMARK(BM_ShardedStockpileTransact, {{1, 64}, {2, 64}, {4, 64}, {8, 64}, {16, 64},
+                                        {32, 64}, {64, 64}, {8, 2}, {64, 2}});
+
+// A two-recipe book shaped like MakeFormula's formulas: two inputs of one
+// unit, one output of two
+namespace static_bench {
+using Forward = StaticFormula<StaticInputs<StaticTerm<0, 1>, StaticTerm<1, 1>>,
+                              StaticOutputs<StaticTerm<2, 2>>>;
+using Backward = StaticFormula<StaticInputs<StaticTerm<2, 1>, StaticTerm<3, 1>>,
+                               StaticOutputs<StaticTerm<0, 2>>>;
+using Book = StaticRecipeBook<4, Forward, Backward>;
+
+Book MakeBook() {
+    return Book(ResourceName(0), ResourceName(1), ResourceName(2), ResourceName(3));
+}
+
+// Alternates the two recipes, with every eighth step a runtime formula
+ExecutablePlan MakeMixedPlan(const Book &book, std::int64_t length) {
+    ExecutablePlan plan(nullptr, 0);
+    Formula forward = book.ToFormula<Forward>();
+    Formula backward = book.ToFormula<Backward>();
+    for (std::int64_t i = 0; i < length; ++i) {
+        plan.Add(i % 8 == 7 ? MakeFormula(i, 4) : Formula(i % 2 ? backward : forward));
+    }
+    return plan;
+}
+} // namespace static_bench
+
+// BM_StockpileTransactLoop with the formula's terms fixed at compile time
+static void BM_StaticFormulaTransactLoop(bench::State &state) {
+    using namespace static_bench;
+    std::int64_t runs = state.range(0);
+    Book book = MakeBook();
+    CompiledPlan program(book.ToFormula<Forward>());
+    CompiledFormula step = program.GetStep(0);
+    Stockpile stockpile;
+    FillStockpile(stockpile, 4, 1 << 30);
+    RandomStream rng;
+    for (auto _ : state) {
+        for (std::int64_t i = 0; i < runs; ++i) {
+            bench::DoNotOptimize(Forward::Apply(stockpile, book.GetSlots(), rng));
+        }
+        if (stockpile.MaxApplications(step) < runs) {
+            FillStockpile(stockpile, 4, 1 << 30);
+        }
+    }
+    state.SetItemsProcessed(state.max_iterations() * runs);
+}
+BENCHMARK(BM_StaticFormulaTransactLoop, {{1}, {64}, {4096}});
+
+static void BM_CompiledExecuteMixed(bench::State &state) {
+    using namespace static_bench;
+    std::int64_t length = state.range(0);
+    Book book = MakeBook();
+    std::shared_ptr<const CompiledPlan> program = MakeMixedPlan(book, length).Compile();
+    Stockpile stockpile;
+    for (auto _ : state) {
+        state.PauseTiming();
+        FillStockpile(stockpile, 4, 1 << 30);
+        stockpile.Reserve(program->GetResourceBound());
+        state.ResumeTiming();
+        bench::DoNotOptimize(program->Execute(0, program->GetSize(), stockpile, 1, false));
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_CompiledExecuteMixed, PlanLengths);
+
+// Same plan, with the book's recipes dispatched to their unrolled code
+static void BM_StaticRecipeBookExecute(bench::State &state) {
+    using namespace static_bench;
+    std::int64_t length = state.range(0);
+    Book book = MakeBook();
+    std::shared_ptr<const CompiledPlan> program = MakeMixedPlan(book, length).Compile();
+    std::vector<std::uint8_t> kinds = book.Classify(*program);
+    Stockpile stockpile;
+    for (auto _ : state) {
+        state.PauseTiming();
+        FillStockpile(stockpile, 4, 1 << 30);
+        stockpile.Reserve(program->GetResourceBound());
+        state.ResumeTiming();
+        bench::DoNotOptimize(book.Execute(*program, kinds, 0, program->GetSize(),
+                                          stockpile, 1, false));
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_StaticRecipeBookExecute, PlanLengths);
+
+// Stocks every other resource, so roughly a quarter of MakeFormula
+// formulas are runnable
+static void FillEveryOther(Stockpile &stockpile, std::int64_t resources) {
+    for (std::int64_t r = 0; r < resources; r += 2) {
+        stockpile.AddResource(ResourceName(r), 1);
+    }
+    stockpile.Reserve(resources);
+}
+
+// The per-formula string path callers used before FeasibilityTable
+static void BM_FeasibilityByName(bench::State &state) {
+    std::int64_t length = state.range(0);
+    ExecutablePlan plan = MakePlan(length, 16384);
+    Stockpile stockpile;
+    FillEveryOther(stockpile, 16384);
+    std::vector<std::uint64_t> mask((length + 63) / 64);
+    for (auto _ : state) {
+        for (int f = 0; f < plan.GetSize(); ++f) {
+            const Formula &formula = plan.GetFormula(f);
+            bool runnable = true;
+            for (int i = 0; i < formula.GetInputSize(); ++i) {
+                runnable = runnable && stockpile.GetQuantity(formula.GetInputName(i)) >=
+                                       formula.GetInputQuantity(i);
+            }
+            mask[f / 64] |= static_cast<std::uint64_t>(runnable) << (f % 64);
+        }
+        bench::DoNotOptimize(mask);
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_FeasibilityByName, PlanLengths);
+
+static void BM_FeasibilityScalar(bench::State &state) {
+    std::int64_t length = state.range(0);
+    FeasibilityTable table(*MakePlan(length, 16384).Compile());
+    Stockpile stockpile;
+    FillEveryOther(stockpile, 16384);
+    std::vector<std::uint64_t> mask;
+    for (auto _ : state) {
+        table.EvaluateScalar(stockpile, mask);
+        bench::DoNotOptimize(mask);
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_FeasibilityScalar, PlanLengths);
+
+// Uses AVX2 where available, otherwise the same loop as above
+static void BM_FeasibilityEvaluate(bench::State &state) {
+    std::int64_t length = state.range(0);
+    FeasibilityTable table(*MakePlan(length, 16384).Compile());
+    Stockpile stockpile;
+    FillEveryOther(stockpile, 16384);
+    std::vector<std::uint64_t> mask;
+    for (auto _ : state) {
+        table.Evaluate(stockpile, mask);
+        bench::DoNotOptimize(mask);
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_FeasibilityEvaluate, PlanLengths);
+
+static void BM_PlanAdd(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::vector<Formula> formulas;
+    for (std::int64_t i = 0; i < length; ++i) {
+        formulas.push_back(MakeFormula(i, 64));
+    }
+    for (auto _ : state) {
+        Plan plan(nullptr, 0);
+        for (std::int64_t i = 0; i < length; ++i) {
+            plan.Add(Formula(formulas[i]));
+        }
+        bench::DoNotOptimize(plan);
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_PlanAdd, PlanLengths);
+
+// Isolates the Plan's own growth cost: formulas are built and the plan is
+// destroyed outside the timed region
+static void BM_PlanAddMoved(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::vector<Formula> formulas;
+    std::unique_ptr<Plan> plan;
+    for (auto _ : state) {
+        state.PauseTiming();
+        plan.reset();
+        formulas.clear();
+        for (std::int64_t i = 0; i < length; ++i) {
+            formulas.push_back(MakeFormula(i, 64));
+        }
+        state.ResumeTiming();
+        plan.reset(new Plan(nullptr, 0));
+        for (std::int64_t i = 0; i < length; ++i) {
+            plan->Add(std::move(formulas[i]));
+        }
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_PlanAddMoved, PlanLengths);
+
+// Same as BM_PlanAddMoved, but reserving once and constructing in place
+static void BM_PlanReserveEmplace(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::vector<Formula> formulas;
+    std::unique_ptr<Plan> plan;
+    for (auto _ : state) {
+        state.PauseTiming();
+        plan.reset();
+        formulas.clear();
+        for (std::int64_t i = 0; i < length; ++i) {
+            formulas.push_back(MakeFormula(i, 64));
+        }
+        state.ResumeTiming();
+        plan.reset(new Plan(nullptr, 0));
+        plan->Reserve(static_cast<int>(length));
+        for (std::int64_t i = 0; i < length; ++i) {
+            plan->Emplace(std::move(formulas[i]));
+        }
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_PlanReserveEmplace, PlanLengths);
+
+static void BM_PlanCopy(bench::State &state) {
+    ExecutablePlan plan = MakePlan(state.range(0), 64);
+    for (auto _ : state) {
+        Plan copy(plan);
+        bench::DoNotOptimize(copy);
+    }
+    state.SetItemsProcessed(state.max_iterations() * state.range(0));
+}
+BENCHMARK(BM_PlanCopy, PlanLengths);
+
+// Maps a saved plan; this process has already interned the names in another
+// order, so it measures the remapping load path rather than the zero-copy one
+static void BM_PlanArchiveLoad(bench::State &state) {
+    const std::string path = "simulator_bench_plan.bin";
+    SavePlan(MakePlan(state.range(0), 64), path);
+    for (auto _ : state) {
+        bench::DoNotOptimize(LoadPlan(path));
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.max_iterations() * state.range(0));
+}
+BENCHMARK(BM_PlanArchiveLoad, PlanLengths);
+
+// Parses a text recipe and runs it batch by batch, as a pipe would feed it
+static void BM_RecipeStream(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::string text;
+    for (std::int64_t i = 0; i < length; ++i) {
+        text += std::to_string(1 + i % 3) + " " + ResourceName(i % 64) +
+                " + 1 " + ResourceName((i * 7) % 64) + " -> 2 " +
+                ResourceName((i * 13) % 64) + "\n";
+    }
+    Stockpile stockpile;
+    FillStockpile(stockpile, 64, 1 << 30);
+    for (auto _ : state) {
+        std::istringstream in(text);
+        RecipeReader reader(in);
+        ExecutablePlan plan(nullptr, 0);
+        bench::DoNotOptimize(reader.Stream(plan, stockpile));
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_RecipeStream, PlanLengths);
+
+// Forks a plan and edits one step, the what-if pattern copies exist for
+static void BM_PlanForkReplace(bench::State &state) {
+    std::int64_t length = state.range(0);
+    ExecutablePlan plan = MakePlan(length, 64);
+    Formula replacement = MakeFormula(length, 64);
+    std::int64_t i = 0;
+    for (auto _ : state) {
+        ExecutablePlan fork(plan);
+        fork.Replace(static_cast<int>(i++ % length), Formula(replacement));
+        bench::DoNotOptimize(fork);
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_PlanForkReplace, PlanLengths);
+
+static void BM_PlanMove(bench::State &state) {
+    Plan plan = MakePlan(state.range(0), 64);
+    for (auto _ : state) {
+        Plan moved(std::move(plan));
+        plan = std::move(moved);
+        bench::DoNotOptimize(plan);
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_PlanMove, PlanLengths);
+
+// One step per call, the way callers drove plans before RunSteps existed
+static void BM_ExecutablePlanApply(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::int64_t resources = state.range(1);
+    ExecutablePlan plan = MakePlan(length, resources);
+    auto stockpile = std::make_shared<Stockpile>();
+    FillStockpile(*stockpile, resources, 1 << 30);
+    ExecutablePlan run(plan);
+    for (auto _ : state) {
+        if (run.GetCurrentStep() == length) {
+            state.PauseTiming();
+            run = plan;
+            state.ResumeTiming();
+        }
+        bench::DoNotOptimize(run.Apply(stockpile));
+    }
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_ExecutablePlanApply, {{1000, 64}, {100000, 64}, {100000, 16384}});
+
+static void BM_ExecutablePlanRunToCompletion(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::int64_t resources = state.range(1);
+    ExecutablePlan plan = MakePlan(length, resources);
+    plan.Compile();
+    for (auto _ : state) {
+        state.PauseTiming();
+        Stockpile stockpile;
+        FillStockpile(stockpile, resources, 1 << 30);
+        ExecutablePlan run(plan);
+        state.ResumeTiming();
+        bench::DoNotOptimize(run.RunToCompletion(stockpile));
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_ExecutablePlanRunToCompletion,
+          {{1000, 64}, {100000, 64}, {100000, 16384}});
+
+// Same run with proficiency progression; every MakePlan step is a distinct
+// formula, so this includes one tracker insertion per step
+static void BM_ExecutablePlanRunTracked(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::int64_t resources = state.range(1);
+    ExecutablePlan plan = MakePlan(length, resources);
+    plan.Compile();
+    for (auto _ : state) {
+        state.PauseTiming();
+        Stockpile stockpile;
+        FillStockpile(stockpile, resources, 1 << 30);
+        ExecutablePlan run(plan);
+        run.TrackProficiency(true);
+        state.ResumeTiming();
+        bench::DoNotOptimize(run.RunToCompletion(stockpile));
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_ExecutablePlanRunTracked,
+          {{1000, 64}, {100000, 64}, {100000, 16384}});
+
+// Hold model: 'pending' events in the queue, each iteration popping the
+// earliest and pushing one a random time later, as a busy simulation does
+static void BM_EventQueueHold(bench::State &state) {
+    std::int64_t pending = state.range(0);
+    RandomStream rng(3);
+    EventQueue queue;
+    queue.Reserve(static_cast<std::size_t>(pending));
+    for (std::int64_t i = 0; i < pending; ++i) {
+        queue.Push(Event{rng.Next() % 1024, static_cast<std::uint32_t>(i), 0});
+    }
+    for (auto _ : state) {
+        Event next = queue.Pop();
+        next.time += 1 + rng.Next() % 1024;
+        queue.Push(next);
+    }
+    bench::DoNotOptimize(queue.Top());
+    state.SetItemsProcessed(state.max_iterations());
+}
+BENCHMARK(BM_EventQueueHold, {{1000}, {65536}, {1000000}});
+
+// A whole plan on one pool of 'machines', with durations varying by step;
+// items are completion events
+static void BM_ProductionSimulatorRun(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::int64_t machines = state.range(1);
+    std::shared_ptr<const CompiledPlan> program = MakePlan(length, 64).Compile();
+    ProductionSimulator factory(program);
+    factory.SetMachines(0, static_cast<int>(machines));
+    for (int i = 0; i < program->GetSize(); ++i) {
+        factory.SetTiming(program->GetStep(i).formulaId, 0,
+                          1 + static_cast<std::uint64_t>(i % 7));
+    }
+    Stockpile stockpile;
+    for (auto _ : state) {
+        state.PauseTiming();
+        FillStockpile(stockpile, 64, 1 << 30);
+        state.ResumeTiming();
+        bench::DoNotOptimize(factory.Run(stockpile, 1));
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_ProductionSimulatorRun, {{100000, 1}, {100000, 64}, {100000, 4096}});
+
+// The static pre-pass over a whole plan; compare BM_CompiledExecuteMixed,
+// which runs one
+static void BM_PlanAnalyzerAnalyze(bench::State &state) {
+    std::int64_t length = state.range(0);
+    std::shared_ptr<const CompiledPlan> program = MakePlan(length, 64).Compile();
+    PlanAnalyzer analyzer(program);
+    Stockpile initial;
+    FillStockpile(initial, 64, 1 << 30);
+    for (auto _ : state) {
+        bench::DoNotOptimize(analyzer.Analyze(initial));
+    }
+    state.SetItemsProcessed(state.max_iterations() * length);
+}
+BENCHMARK(BM_PlanAnalyzerAnalyze, PlanLengths);
+
+// A library of MakeFormula formulas over 256 resources; the target takes
+// three applications of the formulas producing resource 5, so each search
+// expands a few batches of states against the whole library. Items are
+// successors generated.
+static void BM_PlanSynthesizerSearch(bench::State &state) {
+    std::int64_t formulas = state.range(0);
+    std::vector<Formula> library;
+    for (std::int64_t i = 0; i < formulas; ++i) {
+        library.push_back(MakeFormula(i, 256));
+    }
+    SynthesisOptions options;
+    options.threads = static_cast<int>(state.range(1));
+    options.batchSize = 8;
+    PlanSynthesizer synthesizer(library, options);
+    Stockpile initial;
+    FillStockpile(initial, 256, 3);
+    Stockpile target;
+    target.AddResource(ResourceName(5), 9);
+    std::size_t generated = 0;
+    for (auto _ : state) {
+        SynthesisResult result = synthesizer.Search(initial, target);
+        generated += result.generated;
+        bench::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(generated));
+}
+BENCHMARK(BM_PlanSynthesizerSearch, {{256, 1}, {4096, 1}, {4096, 4}});
+
+int main(int argc, char **argv) {
+    return bench::RunAll(argc, argv);
+}
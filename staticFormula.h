@@ -0,0 +1,253 @@
+// AUTHOR:   Tumaris Paris
+// FILENAME: staticFormula.h
+// DATE:     10/15/2026
+// DESCRIPTION: Defines StaticFormula, a formula whose terms are fixed at
+//              compile time, and StaticRecipeBook, which runs compiled plans
+//              through them. A recipe book known when the program is built
+//              is declared as types:
+//
+//                  enum { Water, Carbon, Glucose };
+//                  using MakeGlucose = StaticFormula<
+//                          StaticInputs<StaticTerm<Water, 2>, StaticTerm<Carbon, 1>>,
+//                          StaticOutputs<StaticTerm<Glucose, 1>>>;
+//                  StaticRecipeBook<3, MakeGlucose> book{"Water", "Carbon", "Glucose"};
+//
+//              Term slots name resources only within the book; the book
+//              binds them to registry IDs once, at construction. Everything
+//              else, the counts and the quantities, is a constant, so
+//              checking, debiting and crediting a static formula compiles
+//              to straight-line code the caller can inline whole.
+
+// =============================================================================
+// ----------------------------- CLASS INVARIANTS ------------------------------
+// =============================================================================
+// 1. A StaticFormula applied through a ResourceSlots binding has exactly the
+//    effect of Stockpile::Transact on the equivalent compiled formula,
+//    including for repeated resources and never-stocked ones.
+// 2. StaticRecipeBook::Execute gives the same stockpile, apply log and
+//    RunResult as CompiledPlan::Execute with the same arguments; steps that
+//    match no static formula simply take the runtime path.
+// 3. A step matches a static formula only if its terms, in order, and its
+//    proficiency level are identical, so the tiers drawn do not change.
+
+#ifndef STATICFORMULA_H
+#define STATICFORMULA_H
+
+#include "compiledPlan.h"
+#include "formula.h"
+#include "randomStream.h"
+#include "resourceRegistry.h"
+#include "stockpile.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// One term of a static formula: 'Quantity' of the resource in book slot
+// 'Slot'.
+template <std::size_t Slot, std::int32_t Quantity>
+struct StaticTerm {
+    static_assert(Quantity >= 0, "Term quantities must not be negative");
+    static constexpr std::size_t slot = Slot;
+    static constexpr std::int32_t quantity = Quantity;
+};
+
+template <typename... Terms>
+struct StaticInputs {};
+
+template <typename... Terms>
+struct StaticOutputs {};
+
+// Binds the slots of a recipe book to interned resource IDs.
+template <std::size_t SlotCount>
+class ResourceSlots {
+public:
+    template <typename... Names>
+    explicit ResourceSlots(const Names &... names)
+            : ids{ResourceRegistry::Global().Intern(std::string_view(names))...} {
+        static_assert(sizeof...(Names) == SlotCount, "One name per slot");
+    }
+    // Interns one name per slot, in slot order.
+    // Preconditions: None.
+    // Postconditions: (*this)[slot] is the ID of the slot's name.
+
+    ResourceId operator[](std::size_t slot) const { return ids[slot]; }
+
+private:
+    std::array<ResourceId, SlotCount> ids;
+};
+
+template <typename Inputs, typename Outputs, int Level = 0>
+class StaticFormula;
+
+template <typename... In, typename... Out, int Level>
+class StaticFormula<StaticInputs<In...>, StaticOutputs<Out...>, Level> {
+public:
+    static_assert(Level >= 0 && Level <= Formula::MaxProficiency,
+                  "Proficiency level out of range");
+
+    static constexpr std::size_t InputCount = sizeof...(In);
+    static constexpr std::size_t OutputCount = sizeof...(Out);
+    static constexpr int ProficiencyLevel = Level;
+
+    template <std::size_t SlotCount>
+    static std::array<ResourceAmount, InputCount + OutputCount>
+    Terms(const ResourceSlots<SlotCount> &slots) {
+        static_assert(((In::slot < SlotCount) && ...) && ((Out::slot < SlotCount) && ...),
+                      "Term slot outside the book");
+        return {{ResourceAmount{slots[In::slot], In::quantity}...,
+                 ResourceAmount{slots[Out::slot], Out::quantity}...}};
+    }
+    // Returns the inputs followed by the outputs, as compiled formulas lay
+    // them out.
+
+    template <std::size_t SlotCount>
+    static bool Transact(Stockpile &stockpile, const ResourceSlots<SlotCount> &slots,
+                         MultiplierTier tier) {
+        return stockpile.TransactFixed<InputCount>(Terms(slots), tier);
+    }
+    // Same contract as Stockpile::Transact.
+
+    template <std::size_t SlotCount>
+    static bool CanApply(const Stockpile &stockpile,
+                         const ResourceSlots<SlotCount> &slots) {
+        return (... && (stockpile.GetQuantity(slots[In::slot]) >= In::quantity));
+    }
+    // Returns whether every input is stocked. Assumes no resource repeats
+    // among the inputs; unlike Stockpile::MaxApplications, repeats are not
+    // summed.
+
+    template <std::size_t SlotCount>
+    static bool Apply(Stockpile &stockpile, const ResourceSlots<SlotCount> &slots,
+                      RandomStream &rng) {
+        return Transact(stockpile, slots, Formula::DetermineMultiplier(Level, rng));
+    }
+    // Draws a tier as Formula::Apply would and transacts it.
+
+    template <std::size_t SlotCount>
+    static bool Matches(const CompiledFormula &step,
+                        const ResourceSlots<SlotCount> &slots) {
+        if (step.inputCount != static_cast<int>(InputCount) ||
+            step.outputCount != static_cast<int>(OutputCount) ||
+            step.proficiencyLevel != Level) {
+            return false;
+        }
+        const auto terms = Terms(slots);
+        for (std::size_t i = 0; i < terms.size(); ++i) {
+            // Outputs directly follow inputs in compiled storage
+            const ResourceAmount &term = step.inputs[i];
+            if (term.id != terms[i].id || term.quantity != terms[i].quantity) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // Returns whether a compiled step, e.g. one loaded at run time, is this
+    // formula under 'slots'.
+
+    template <std::size_t SlotCount>
+    static Formula ToFormula(const ResourceSlots<SlotCount> &slots) {
+        const ResourceRegistry &registry = ResourceRegistry::Global();
+        const auto terms = Terms(slots);
+        // Formula takes ownership of the arrays
+        std::string *inputNames = new std::string[InputCount];
+        int *inputQuantities = new int[InputCount];
+        std::string *outputNames = new std::string[OutputCount];
+        int *outputQuantities = new int[OutputCount];
+        for (std::size_t i = 0; i < InputCount; ++i) {
+            inputNames[i] = registry.Name(terms[i].id);
+            inputQuantities[i] = terms[i].quantity;
+        }
+        for (std::size_t i = 0; i < OutputCount; ++i) {
+            outputNames[i] = registry.Name(terms[InputCount + i].id);
+            outputQuantities[i] = terms[InputCount + i].quantity;
+        }
+        Formula formula(inputNames, inputQuantities, static_cast<int>(InputCount),
+                        outputNames, outputQuantities, static_cast<int>(OutputCount));
+        formula.SetProficiencyLevel(Level);
+        return formula;
+    }
+    // Builds the equivalent runtime Formula, e.g. to add to a Plan. Each
+    // call creates a new formula identity.
+};
+
+// A fixed set of static formulas over one slot binding.
+template <std::size_t SlotCount, typename... Formulas>
+class StaticRecipeBook {
+public:
+    static_assert(sizeof...(Formulas) < 255, "Too many static formulas");
+
+    // Kind of a step that no static formula matches
+    static constexpr std::uint8_t Runtime = 255;
+
+    template <typename... Names>
+    explicit StaticRecipeBook(const Names &... names) : slots(names...) {}
+    // Binds the book's slots to 'names', in slot order.
+
+    const ResourceSlots<SlotCount> &GetSlots() const { return slots; }
+
+    template <typename Recipe>
+    Formula ToFormula() const { return Recipe::ToFormula(slots); }
+    // Builds the runtime Formula for one of the book's recipes.
+
+    std::vector<std::uint8_t> Classify(const CompiledPlan &program) const {
+        std::vector<std::uint8_t> kinds(program.GetSize());
+        for (int i = 0; i < program.GetSize(); ++i) {
+            kinds[i] = Match(program.GetStep(i), std::index_sequence_for<Formulas...>{});
+        }
+        return kinds;
+    }
+    // Returns, per step, the index of the first formula of the book the
+    // step matches, or Runtime. Done once per plan.
+
+    RunResult Execute(const CompiledPlan &program, const std::vector<std::uint8_t> &kinds,
+                      int begin, int end, Stockpile &stockpile, std::uint64_t seed,
+                      bool record, std::uint64_t stepBase = 0) const {
+        for (int i = begin; i < end; ++i) {
+            const std::uint64_t number = stepBase + static_cast<std::uint64_t>(i);
+            RandomStream rng(seed, number);
+            CompiledFormula step = program.GetStep(i);
+            MultiplierTier tier = Formula::DetermineMultiplier(step.proficiencyLevel, rng);
+            if (!Dispatch(kinds[i], step, stockpile, tier,
+                          std::index_sequence_for<Formulas...>{})) {
+                return RunResult{i - begin, i};
+            }
+            if (record) {
+                stockpile.StoreFormulaResult(
+                        ApplyRecord{static_cast<std::uint32_t>(number), step.formulaId,
+                                    tier}, step);
+            }
+        }
+        return RunResult{end - begin, -1};
+    }
+    // Same contract as CompiledPlan::Execute, with 'kinds' from Classify on
+    // 'program'; matched steps run their static formula's unrolled code.
+
+private:
+    template <std::size_t... Is>
+    std::uint8_t Match(const CompiledFormula &step, std::index_sequence<Is...>) const {
+        std::uint8_t kind = Runtime;
+        // Stops at the first match
+        (void) ((Formulas::Matches(step, slots) ? (kind = Is, true) : false) || ...);
+        return kind;
+    }
+
+    template <std::size_t... Is>
+    bool Dispatch(std::uint8_t kind, const CompiledFormula &step, Stockpile &stockpile,
+                  MultiplierTier tier, std::index_sequence<Is...>) const {
+        bool applied = false;
+        if (!((kind == Is ? (applied = Formulas::Transact(stockpile, slots, tier), true)
+                          : false) || ...)) {
+            applied = stockpile.Transact(step, tier);
+        }
+        return applied;
+    }
+
+    ResourceSlots<SlotCount> slots;
+};
+
+#endif // STATICFORMULA_H
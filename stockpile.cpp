@@ -1,32 +1,280 @@
 #include "stockpile.h"
+#include "formula.h"
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 
-Stockpile::Stockpile() = default;
+Stockpile::Stockpile() : journaling(false), nextGeneration(1) {}
 
-void Stockpile::AddResource(const std::string& name, int quantity) {
-    resources[name] += quantity;
+void Stockpile::AddResource(std::string_view name, int quantity) {
+    AddResource(ResourceRegistry::Global().Intern(name), quantity);
 }
 
-bool Stockpile::ConsumeResource(const std::string& name, int quantity) {
-    if (resources.find(name) != resources.end() && resources[name] >= quantity) {
-        resources[name] -= quantity;
+bool Stockpile::ConsumeResource(std::string_view name, int quantity) {
+    ResourceId id = ResourceRegistry::Global().Find(name);
+    if (id == InvalidResource) {
+        return false;
+    }
+    return ConsumeResource(id, quantity);
+}
+
+int Stockpile::GetQuantity(std::string_view name) const {
+    ResourceId id = ResourceRegistry::Global().Find(name);
+    if (id == InvalidResource) {
+        return 0;
+    }
+    return static_cast<int>(GetQuantity(id));
+}
+
+// AddResource: Only growing the storage consults the registry, so adding
+// to a resource that already has a slot stays lock-free.
+void Stockpile::AddResource(ResourceId id, std::int64_t quantity) {
+    if (id >= quantities.size()) {
+        if (id >= ResourceRegistry::Global().Size()) {
+            throw std::out_of_range("Resource was never interned");
+        }
+        Reserve(static_cast<std::size_t>(id) + 1);
+    }
+    Record(id);
+    quantities[id] += quantity;
+}
+
+bool Stockpile::ConsumeResource(ResourceId id, std::int64_t quantity) {
+    if (id < quantities.size() && quantities[id] >= quantity) {
+        Record(id);
+        quantities[id] -= quantity;
         return true;
     }
     return false;
 }
 
-int Stockpile::GetQuantity(const std::string& name) const {
-    auto it = resources.find(name);
-    if (it != resources.end()) {
-        return it->second;
+std::int64_t Stockpile::GetQuantity(ResourceId id) const {
+    if (id < quantities.size()) {
+        return quantities[id];
     }
     return 0;
 }
 
-void Stockpile::StoreFormulaResult(const std::string& result) {
-    applyResults.push_back(result);
+void Stockpile::Reserve(std::size_t bound) {
+    if (bound > quantities.size()) {
+        quantities.resize(bound, 0);
+    }
+}
+
+std::size_t Stockpile::GetResourceBound() const {
+    return quantities.size();
+}
+
+const std::int64_t* Stockpile::GetQuantities() const {
+    return quantities.data();
+}
+
+bool Stockpile::Transact(const CompiledFormula& formula, MultiplierTier tier) {
+    std::int64_t* slots = quantities.data();
+    const std::size_t bound = quantities.size();
+    const std::size_t journalMark = journal.size();
+    if (journaling) {
+        // Outputs directly follow inputs in the compiled terms
+        const int terms = formula.inputCount + formula.outputCount;
+        for (int i = 0; i < terms; ++i) {
+            Record(formula.inputs[i].id);
+        }
+    }
+    for (int i = 0; i < formula.inputCount; ++i) {
+        const ResourceAmount& input = formula.inputs[i];
+        if (input.id >= bound) {
+            // Never stocked, so only a zero need is met; there is no slot
+            // to debit either way
+            if (input.quantity == 0) {
+                continue;
+            }
+        } else if (slots[input.id] >= input.quantity) {
+            slots[input.id] -= input.quantity;
+            continue;
+        }
+        while (i-- > 0) {
+            if (formula.inputs[i].id < bound) {
+                slots[formula.inputs[i].id] += formula.inputs[i].quantity;
+            }
+        }
+        journal.resize(journalMark);
+        return false;
+    }
+    for (int i = 0; i < formula.outputCount; ++i) {
+        const ResourceAmount& output = formula.outputs[i];
+        if (output.id >= quantities.size()) {
+            Reserve(static_cast<std::size_t>(output.id) + 1);
+        }
+        quantities[output.id] += AdjustQuantity(output.quantity, tier);
+    }
+    return true;
+}
+
+// MaxApplications: A resource named more than once is counted at its
+// first occurrence, against the sum of all its needs, as TransactBatch
+// debits them one after another.
+std::int64_t Stockpile::MaxApplications(const CompiledFormula& formula) const {
+    std::int64_t runs = std::numeric_limits<std::int64_t>::max();
+    for (int i = 0; i < formula.inputCount; ++i) {
+        const ResourceId id = formula.inputs[i].id;
+        bool seen = false;
+        for (int j = 0; j < i && !seen; ++j) {
+            seen = formula.inputs[j].id == id;
+        }
+        if (seen) {
+            continue;
+        }
+        std::int64_t need = 0;
+        for (int j = i; j < formula.inputCount; ++j) {
+            if (formula.inputs[j].id == id) {
+                need += formula.inputs[j].quantity;
+            }
+        }
+        if (need > 0) {
+            runs = std::min(runs, GetQuantity(id) / need);
+        }
+    }
+    return runs;
+}
+
+bool Stockpile::TransactBatch(const CompiledFormula& formula,
+                              const std::int64_t tierCounts[TierCount]) {
+    std::int64_t runs = 0;
+    for (int tier = 0; tier < TierCount; ++tier) {
+        runs += tierCounts[tier];
+    }
+    if (runs == 0) {
+        return true;
+    }
+
+    const std::size_t journalMark = journal.size();
+    if (journaling) {
+        const int terms = formula.inputCount + formula.outputCount;
+        for (int i = 0; i < terms; ++i) {
+            Record(formula.inputs[i].id);
+        }
+    }
+    // Same debit-then-roll-back pass as Transact; the division keeps
+    // runs * quantity from overflowing before it is known to fit the stock
+    std::int64_t* slots = quantities.data();
+    const std::size_t bound = quantities.size();
+    for (int i = 0; i < formula.inputCount; ++i) {
+        const ResourceAmount& input = formula.inputs[i];
+        if (input.quantity == 0) {
+            continue;
+        }
+        if (input.id >= bound || slots[input.id] / input.quantity < runs) {
+            while (i-- > 0) {
+                // Skipped zero needs may name IDs past the bound
+                if (formula.inputs[i].id < bound) {
+                    slots[formula.inputs[i].id] += runs * formula.inputs[i].quantity;
+                }
+            }
+            journal.resize(journalMark);
+            return false;
+        }
+        slots[input.id] -= runs * input.quantity;
+    }
+    for (int i = 0; i < formula.outputCount; ++i) {
+        const ResourceAmount& output = formula.outputs[i];
+        std::int64_t credit = 0;
+        for (int tier = 0; tier < TierCount; ++tier) {
+            credit += tierCounts[tier] *
+                      AdjustQuantity(output.quantity,
+                                     static_cast<MultiplierTier>(tier));
+        }
+        if (output.id >= quantities.size()) {
+            Reserve(static_cast<std::size_t>(output.id) + 1);
+        }
+        quantities[output.id] += credit;
+    }
+    return true;
+}
+
+std::int64_t Stockpile::ApplyRepeatedly(const CompiledFormula& formula,
+                                        std::int64_t runs, RandomStream& rng) {
+    runs = std::min(runs, MaxApplications(formula));
+    if (runs <= 0) {
+        return 0;
+    }
+    std::int64_t tierCounts[TierCount];
+    Formula::SampleTierCounts(formula.proficiencyLevel, runs, rng, tierCounts);
+    return TransactBatch(formula, tierCounts) ? runs : 0;
+}
+
+void Stockpile::StoreFormulaResult(const ApplyRecord& record, const CompiledFormula& formula) {
+    applyLog.Append(record, formula);
+}
+
+void Stockpile::ReserveApplyLog(std::size_t records, std::size_t outputTerms) {
+    applyLog.Reserve(records, outputTerms);
+}
+
+const ApplyLog& Stockpile::GetApplyLog() const {
+    return applyLog;
+}
+
+std::vector<std::string> Stockpile::GetApplyResults() const {
+    std::vector<std::string> results;
+    results.reserve(applyLog.GetSize());
+    for (std::size_t i = 0; i < applyLog.GetSize(); ++i) {
+        results.push_back(applyLog.Format(i));
+    }
+    return results;
+}
+
+// Checkpoint: Reuses the newest live checkpoint when nothing changed since
+// it, so a loop of checkpoint, explore, roll back keeps one live entry.
+StockpileCheckpoint Stockpile::Checkpoint() {
+    journaling = true;
+    if (!liveCheckpoints.empty() &&
+        liveCheckpoints.back().journalSize == journal.size() &&
+        liveCheckpoints.back().logSize == applyLog.GetSize()) {
+        return liveCheckpoints.back();
+    }
+    liveCheckpoints.push_back(
+            StockpileCheckpoint{journal.size(), applyLog.GetSize(), nextGeneration++});
+    return liveCheckpoints.back();
+}
+
+void Stockpile::RollbackTo(const StockpileCheckpoint& checkpoint) {
+    // Generations grow with each new checkpoint, so the live list is sorted
+    auto live = std::lower_bound(
+            liveCheckpoints.begin(), liveCheckpoints.end(), checkpoint.generation,
+            [](const StockpileCheckpoint& entry, std::uint64_t generation) {
+                return entry.generation < generation;
+            });
+    if (live == liveCheckpoints.end() || live->generation != checkpoint.generation ||
+        live->journalSize != checkpoint.journalSize || live->logSize != checkpoint.logSize) {
+        throw std::invalid_argument("Checkpoint is no longer valid.");
+    }
+    // Undo newest first, so a resource changed several times ends up with
+    // the value it had at the checkpoint. An ID without a slot was only
+    // read, never written
+    for (std::size_t i = journal.size(); i-- > checkpoint.journalSize;) {
+        if (journal[i].id < quantities.size()) {
+            quantities[journal[i].id] = journal[i].previous;
+        }
+    }
+    journal.resize(checkpoint.journalSize);
+    applyLog.Truncate(checkpoint.logSize);
+    // Checkpoints taken after this one describe states that are gone
+    liveCheckpoints.erase(live + 1, liveCheckpoints.end());
+}
+
+void Stockpile::DiscardCheckpoints() {
+    journal.clear();
+    liveCheckpoints.clear();
+    journaling = false;
 }
 
-std::vector<std::string>& Stockpile::GetApplyResults() {
-    return applyResults;
-};
+std::size_t Stockpile::GetJournalSize() const {
+    return journal.size();
+}
+
+void Stockpile::Record(ResourceId id) {
+    if (journaling) {
+        journal.push_back(JournalEntry{id, GetQuantity(id)});
+    }
+}
@@ -1,30 +1,182 @@
 #ifndef STOCKPILE_H
 #define STOCKPILE_H
 
-#include <map>
+#include "applyLog.h"
+#include "randomStream.h"
+#include "resourceRegistry.h"
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
+// Position in a Stockpile's undo journal, returned by Checkpoint()
+struct StockpileCheckpoint {
+    std::size_t journalSize;   // Journal entries recorded before the checkpoint
+    std::size_t logSize;       // Apply log records stored before the checkpoint
+    std::uint64_t generation;  // Identity; never reused by the Stockpile
+};
+
 class Stockpile {
 public:
     Stockpile();
     Stockpile(const Stockpile&) = delete; // Suppress copying
     Stockpile& operator=(const Stockpile&) = delete;
 
-    void AddResource(const std::string& name, int quantity);
-    bool ConsumeResource(const std::string& name, int quantity);
-    int GetQuantity(const std::string& name) const;
+    // Name API, kept as a thin layer over the interned-ID API below. Only
+    // AddResource of a name never seen before allocates.
+    void AddResource(std::string_view name, int quantity);
+    bool ConsumeResource(std::string_view name, int quantity);
+    int GetQuantity(std::string_view name) const;
+
+    // ID API used on the hot path; IDs come from ResourceRegistry::Global()
+
+    // Adds 'quantity' of resource 'id', growing the storage to give it a
+    // slot if needed. Throws std::out_of_range, changing nothing, if 'id'
+    // was never interned, e.g. an unchecked InvalidResource from Find().
+    void AddResource(ResourceId id, std::int64_t quantity);
+
+    // Removes 'quantity' of resource 'id' if that much is in stock and
+    // returns true; otherwise changes nothing and returns false. IDs without
+    // a slot, InvalidResource included, hold nothing.
+    bool ConsumeResource(ResourceId id, std::int64_t quantity);
+
+    // Returns the quantity of resource 'id', or 0 if it has no slot.
+    std::int64_t GetQuantity(ResourceId id) const;
+
+    // Grows the dense storage so that every ID below 'bound' has a slot
+    void Reserve(std::size_t bound);
+
+    // Returns one past the largest ID that has a slot
+    std::size_t GetResourceBound() const;
+
+    // Dense quantities indexed by ResourceId, GetResourceBound() of them.
+    // Valid until the stockpile next grows.
+    const std::int64_t* GetQuantities() const;
+
+    // Debits every input of 'formula' and credits its outputs adjusted by
+    // 'tier', in one pass. If any input is short, the inputs already debited
+    // are rolled back, the stockpile is left unchanged and false is returned.
+    bool Transact(const CompiledFormula& formula, MultiplierTier tier);
+
+    // Transact for a formula whose term counts are known at compile time,
+    // as StaticFormula's are: the first InputCount terms are its inputs and
+    // the rest its outputs. The loops have constant bounds, so once inlined
+    // into a caller whose quantities are constants they unroll into
+    // straight-line code. While journaling it defers to Transact.
+    template <std::size_t InputCount, std::size_t TermCount>
+    bool TransactFixed(const std::array<ResourceAmount, TermCount>& terms,
+                       MultiplierTier tier);
+
+    // Returns how many times 'formula' could be applied at once, i.e. the
+    // minimum over its inputs of floor(stock / need), where a resource
+    // named more than once needs the sum of its quantities. Returns
+    // INT64_MAX for a formula without inputs that need anything.
+    std::int64_t MaxApplications(const CompiledFormula& formula) const;
 
-    // New method to store formula application results
-    void StoreFormulaResult(const std::string& result);
+    // Applies 'formula' sum(tierCounts) times as one transaction: debits
+    // every input that many times, then credits each output once per run
+    // with that run's tier, as that many Transact calls would. Inputs are
+    // all debited before any output is credited, so a formula that outputs
+    // one of its own inputs needs the full amount up front. On shortage the
+    // stockpile is left unchanged and false is returned.
+    // Preconditions: tierCounts, indexed by MultiplierTier, are >= 0 and
+    //                the resulting quantities fit in 64 bits.
+    bool TransactBatch(const CompiledFormula& formula,
+                       const std::int64_t tierCounts[TierCount]);
 
-    // New method to display stored formula results
-    std::vector<std::string>& GetApplyResults();
+    // Applies 'formula' min(runs, MaxApplications(formula)) times in
+    // O(inputs + outputs), sampling the tier counts from their multinomial
+    // distribution instead of drawing each run's tier. Returns the number
+    // of runs applied. Batched runs are not added to the apply log.
+    std::int64_t ApplyRepeatedly(const CompiledFormula& formula,
+                                 std::int64_t runs, RandomStream& rng);
+
+    // Appends a formula application record and its outputs to the log
+    void StoreFormulaResult(const ApplyRecord& record, const CompiledFormula& formula);
+
+    // Preallocates the log for the given number of records and output terms
+    void ReserveApplyLog(std::size_t records, std::size_t outputTerms);
+
+    const ApplyLog& GetApplyLog() const;
+
+    // Formats every stored result; intended for display, not the hot path
+    std::vector<std::string> GetApplyResults() const;
+
+    // Marks the current state and starts journaling every change to a
+    // quantity, so that RollbackTo can undo them. Checkpoints nest: any
+    // checkpoint taken since the last DiscardCheckpoints stays valid until
+    // a rollback to an earlier one. Checkpoints taken with no change in
+    // between are the same checkpoint.
+    StockpileCheckpoint Checkpoint();
+
+    // Restores the quantities and apply log recorded by 'checkpoint', in
+    // time proportional to the changes made since, not to the stockpile
+    // size. Journaling continues, so the checkpoint can be rolled back to
+    // again. Throws std::invalid_argument if 'checkpoint' is not valid.
+    void RollbackTo(const StockpileCheckpoint& checkpoint);
+
+    // Keeps the current state, drops the journal and stops journaling.
+    // Every outstanding checkpoint becomes invalid.
+    void DiscardCheckpoints();
+
+    // Number of journal entries recorded since the first live checkpoint
+    std::size_t GetJournalSize() const;
 
 private:
-    std::map<std::string, int> resources;
-    std::vector<std::string> applyResults; // Stores results of formula applications
+    // Quantity of a resource before a journaled change
+    struct JournalEntry {
+        ResourceId id;
+        std::int64_t previous;
+    };
+
+    void Record(ResourceId id);
+    // Appends the current quantity of 'id' to the journal when journaling.
+
+    std::vector<std::int64_t> quantities; // Indexed by ResourceId
+    ApplyLog applyLog; // Stores results of formula applications
+    std::vector<JournalEntry> journal; // Undo entries, oldest first
+    bool journaling; // True while any checkpoint is live
+    std::vector<StockpileCheckpoint> liveCheckpoints; // Valid ones, oldest first
+    std::uint64_t nextGeneration; // Generation of the next new checkpoint
 };
 
+template <std::size_t InputCount, std::size_t TermCount>
+inline bool Stockpile::TransactFixed(const std::array<ResourceAmount, TermCount>& terms,
+                                     MultiplierTier tier) {
+    static_assert(InputCount <= TermCount, "More inputs than terms");
+    if (journaling) {
+        return Transact(CompiledFormula{terms.data(), static_cast<int>(InputCount),
+                                        terms.data() + InputCount,
+                                        static_cast<int>(TermCount - InputCount), 0, 0},
+                        tier);
+    }
+    std::int64_t* slots = quantities.data();
+    const std::size_t bound = quantities.size();
+    for (std::size_t i = 0; i < InputCount; ++i) {
+        if (terms[i].id >= bound) {
+            if (terms[i].quantity == 0) {
+                continue;
+            }
+        } else if (slots[terms[i].id] >= terms[i].quantity) {
+            slots[terms[i].id] -= terms[i].quantity;
+            continue;
+        }
+        while (i-- > 0) {
+            if (terms[i].id < bound) {
+                slots[terms[i].id] += terms[i].quantity;
+            }
+        }
+        return false;
+    }
+    for (std::size_t i = InputCount; i < TermCount; ++i) {
+        if (terms[i].id >= quantities.size()) {
+            Reserve(static_cast<std::size_t>(terms[i].id) + 1);
+        }
+        quantities[terms[i].id] += AdjustQuantity(terms[i].quantity, tier);
+    }
+    return true;
+}
+
 #endif // STOCKPILE_H